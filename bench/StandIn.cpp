@@ -0,0 +1,210 @@
+/**
+ * @file StandIn.cpp
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include "StandIn.h"
+
+namespace ecoBee {
+    namespace {
+        /**
+         * How often blocked threads look for a stop request.
+         */
+        constexpr int PollMilliseconds = 100;
+
+        /**
+         * @brief Wait for a socket to be readable.
+         * @return False if the server is stopping.
+         */
+        bool readable(const std::stop_token &stop, int fd) {
+            pollfd pfd{fd, POLLIN, 0};
+            while (!stop.stop_requested()) {
+                if (auto ready = ::poll(&pfd, 1, PollMilliseconds); ready > 0)
+                    return true;
+                else if (ready < 0 && errno != EINTR)
+                    return false;
+            }
+            return false;
+        }
+
+        bool sendAll(int fd, std::string_view data) {
+            while (!data.empty()) {
+                auto count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (count < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return false;
+                }
+                data.remove_prefix(static_cast<std::size_t>(count));
+            }
+            return true;
+        }
+
+        /**
+         * @brief The value of a header in a request head, empty if it is not present.
+         */
+        std::string_view header(std::string_view head, std::string_view name) {
+            for (std::size_t pos = head.find("\r\n"); pos != std::string_view::npos;) {
+                auto end = head.find("\r\n", pos + 2);
+                auto line = head.substr(pos + 2, end == std::string_view::npos ? end : end - pos - 2);
+                pos = end;
+                if (line.size() <= name.size() || line[name.size()] != ':')
+                    continue;
+                if (!std::equal(name.begin(), name.end(), line.begin(), [](char a, char b) {
+                    return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+                }))
+                    continue;
+                auto value = line.substr(name.size() + 1);
+                while (!value.empty() && value.front() == ' ')
+                    value.remove_prefix(1);
+                return value;
+            }
+            return {};
+        }
+
+        std::string_view reason(int status) {
+            switch (status) {
+                case 200:
+                    return "OK";
+                case 204:
+                    return "No Content";
+                case 404:
+                    return "Not Found";
+                case 500:
+                    return "Internal Server Error";
+                default:
+                    return "Unknown";
+            }
+        }
+    }
+
+    StandInServer::StandInServer(Handler handler, Options options)
+            : mHandler(std::move(handler)), mOptions(options), mRandom(options.seed) {
+        mListen = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (mListen < 0)
+            throw StandInError(std::string{"Stand-in socket: "} + strerror(errno));
+
+        int on = 1;
+        ::setsockopt(mListen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (::bind(mListen, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+            ::listen(mListen, SOMAXCONN) < 0 ||
+            ::getsockname(mListen, reinterpret_cast<sockaddr *>(&address), &length) < 0) {
+            auto error = errno;
+            ::close(mListen);
+            throw StandInError(std::string{"Stand-in listen: "} + strerror(error));
+        }
+        mPort = ntohs(address.sin_port);
+        mAcceptor = std::jthread{[this](const std::stop_token &stop) { accept(stop); }};
+    }
+
+    StandInServer::~StandInServer() {
+        mAcceptor.request_stop();
+        if (mAcceptor.joinable())
+            mAcceptor.join();
+
+        // The acceptor has stopped, no connection is added while they are stopped.
+        for (auto &connection : mConnections)
+            connection.request_stop();
+        mConnections.clear();
+        ::close(mListen);
+    }
+
+    std::string StandInServer::url() const {
+        return "http://127.0.0.1:" + std::to_string(mPort);
+    }
+
+    bool StandInServer::chooseFailure() {
+        if (mOptions.errorRate <= 0.)
+            return false;
+        std::lock_guard lock{mMutex};
+        return std::uniform_real_distribution<double>{}(mRandom) < mOptions.errorRate;
+    }
+
+    void StandInServer::accept(const std::stop_token &stop) {
+        while (readable(stop, mListen)) {
+            auto fd = ::accept4(mListen, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue;
+            int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            std::lock_guard lock{mMutex};
+            mConnections.emplace_back([this, fd](const std::stop_token &connectionStop) {
+                serve(connectionStop, fd);
+                ::close(fd);
+            });
+        }
+    }
+
+    void StandInServer::serve(const std::stop_token &stop, int fd) {
+        std::string buffer{};
+        char chunk[16384];
+        auto receive = [&]() {
+            if (!readable(stop, fd))
+                return false;
+            auto count = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (count <= 0)
+                return false;
+            buffer.append(chunk, static_cast<std::size_t>(count));
+            return true;
+        };
+
+        for (;;) {
+            std::size_t headEnd;
+            while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+                if (!receive())
+                    return;
+            }
+
+            std::string_view head{buffer.data(), headEnd};
+            Request request{};
+            auto method = head.find(' ');
+            auto target = head.find(' ', method + 1);
+            if (method == std::string_view::npos || target == std::string_view::npos)
+                return;
+            request.method = head.substr(0, method);
+            request.target = head.substr(method + 1, target - method - 1);
+
+            std::size_t bodyLength{0};
+            auto contentLength = header(head, "Content-Length");
+            std::from_chars(contentLength.data(), contentLength.data() + contentLength.size(), bodyLength);
+            if (header(head, "Expect") == "100-continue" && !sendAll(fd, "HTTP/1.1 100 Continue\r\n\r\n"))
+                return;
+
+            while (buffer.size() < headEnd + 4 + bodyLength) {
+                if (!receive())
+                    return;
+            }
+            request.body = buffer.substr(headEnd + 4, bodyLength);
+            buffer.erase(0, headEnd + 4 + bodyLength);
+
+            auto response = mHandler(request, chooseFailure());
+            if (mOptions.latency.count())
+                std::this_thread::sleep_for(mOptions.latency);
+
+            auto text = std::string{"HTTP/1.1 "}.append(std::to_string(response.status)).append(1, ' ')
+                    .append(reason(response.status)).append("\r\nContent-Type: ").append(response.contentType)
+                    .append("\r\nContent-Length: ").append(std::to_string(response.body.size()))
+                    .append("\r\n\r\n").append(response.body);
+            ++mRequests;
+            if (!sendAll(fd, text))
+                return;
+        }
+    }
+
+} // ecoBee
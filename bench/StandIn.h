@@ -0,0 +1,111 @@
+/**
+ * @file StandIn.h
+ * @brief A minimal local HTTP/1.1 server standing in for the ecobee API or InfluxDB.
+ * @details The server listens on an ephemeral port of the loopback interface and answers each request with a
+ * handler. Connections are kept alive and served on a thread each. Every response can be delayed, and a
+ * share of the requests can be marked for the handler to fail, so the network path can be measured under
+ * latency and errors without a network.
+ */
+
+#ifndef ECOBEEDATA_STANDIN_H
+#define ECOBEEDATA_STANDIN_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace ecoBee {
+
+    class StandInError : public std::runtime_error {
+    public:
+        explicit StandInError(const std::string &what_arg) : std::runtime_error(what_arg) {}
+    };
+
+    /**
+     * @class StandInServer
+     */
+    class StandInServer {
+    public:
+        struct Request {
+            std::string method{};
+            std::string target{};       ///< The path and query.
+            std::string body{};
+        };
+
+        struct Response {
+            int status{200};
+            std::string body{};
+            std::string contentType{"application/json;charset=UTF-8"};
+        };
+
+        /**
+         * A handler answers a request, fail is true if the request was chosen to fail.
+         */
+        using Handler = std::function<Response(const Request &request, bool fail)>;
+
+        struct Options {
+            std::chrono::milliseconds latency{0};   ///< The delay before each response.
+            double errorRate{0.};                   ///< The share of requests chosen to fail, 0 to 1.
+            std::uint32_t seed{1};                  ///< The seed of the failure choice.
+        };
+
+    private:
+        Handler mHandler;
+        Options mOptions;
+        int mListen{-1};
+        unsigned short mPort{0};
+        std::atomic<std::size_t> mRequests{0};
+
+        std::mutex mMutex{};
+        std::mt19937 mRandom;
+        std::list<std::jthread> mConnections{};
+        std::jthread mAcceptor{};
+
+        void accept(const std::stop_token &stop);
+
+        void serve(const std::stop_token &stop, int fd);
+
+        bool chooseFailure();
+
+    public:
+        StandInServer() = delete;
+        StandInServer(const StandInServer &) = delete;
+        StandInServer &operator=(const StandInServer &) = delete;
+
+        /**
+         * @brief Start listening and serving.
+         * @throws StandInError if the server socket can not be opened.
+         */
+        StandInServer(Handler handler, Options options);
+
+        /**
+         * @brief Stop serving and close every connection.
+         */
+        ~StandInServer();
+
+        /**
+         * @brief The base URL of the server, http://127.0.0.1:port.
+         */
+        [[nodiscard]] std::string url() const;
+
+        [[nodiscard]] unsigned short port() const {
+            return mPort;
+        }
+
+        /**
+         * @brief The number of requests answered.
+         */
+        [[nodiscard]] std::size_t requests() const {
+            return mRequests.load();
+        }
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_STANDIN_H
@@ -0,0 +1,159 @@
+/**
+ * @file Synthetic.cpp
+ */
+
+#include <array>
+#include <ctime>
+#include <stdexcept>
+#include <string_view>
+#include "Synthetic.h"
+
+namespace ecoBee {
+    namespace {
+        constexpr std::string_view CsvHeader = "Date,Time,System Setting,System Mode,Calendar Event,Program Mode,"
+                                               "Cool Set Temp (F),Heat Set Temp (F),Current Temp (F),"
+                                               "Current Humidity (%RH),Outdoor Temp (F),Wind Speed (km/h),"
+                                               "Cool Stage 1 (sec),Heat Stage 1 (sec),Fan (sec),DM Offset,"
+                                               "Thermostat Temperature (F),Thermostat Humidity (%RH),"
+                                               "Thermostat Motion,Thermostat Air Pressure";
+
+        constexpr std::string_view ReportColumns = "hvacMode,zoneHvacMode,zoneClimate,zoneAveTemp,auxHeat1,"
+                                                   "compCool1,fan,zoneHeatTemp,zoneCoolTemp,outdoorTemp,"
+                                                   "outdoorHumidity,wind";
+
+        constexpr std::array<std::string_view, 4> SystemModes = {
+                "heatStage1On", "heatOff", "compressorCoolStage1On", "compressorCoolOff"
+        };
+
+        constexpr std::array<std::string_view, 3> Climates = {"Home", "Away", "Sleep"};
+
+        /**
+         * Operating seconds in an interval, mostly off or on for the whole interval.
+         */
+        constexpr std::array<std::string_view, 5> Seconds = {"0", "0", "300", "120", "45"};
+
+        constexpr std::time_t StartTime = 1640995200;   // 2022-01-01 00:00:00
+        constexpr std::time_t Interval = 300;
+    }
+
+    Synthetic::Synthetic(Options options) : mOptions(options), mRandom(options.seed) {
+        if (mOptions.days < 1 || mOptions.days > MaximumDays)
+            throw std::invalid_argument("Synthetic days out of range.");
+        if (mOptions.sensors > MaximumSensors)
+            throw std::invalid_argument("Synthetic sensors out of range.");
+    }
+
+    std::string Synthetic::tenths(int minimum, unsigned range) {
+        auto value = minimum * 10 + static_cast<int>(pick(range * 10));
+        std::string result = value < 0 ? "-" : "";
+        value = value < 0 ? -value : value;
+        result.append(std::to_string(value / 10)).append(1, '.').append(1, static_cast<char>('0' + value % 10));
+        return result;
+    }
+
+    std::string Synthetic::dateTime(std::size_t row) {
+        // The time is stepped in UTC so there are no daylight saving time gaps or repeats.
+        std::time_t time = StartTime + static_cast<std::time_t>(row) * Interval;
+        std::tm tm{};
+        gmtime_r(&time, &tm);
+        char buf[32];
+        strftime(buf, sizeof(buf), "%Y-%m-%d,%H:%M:%S", &tm);
+        return std::string{buf};
+    }
+
+    std::string Synthetic::csvExport() {
+        std::string csv{"\357\273\277#,Thermostat,Synthetic\n"};
+        csv.append(CsvHeader);
+        for (unsigned sensor = 0; sensor < mOptions.sensors; ++sensor) {
+            auto name = "Sensor " + std::to_string(sensor);
+            csv.append(1, ',').append(name).append(" (F),").append(name).append(" Motion");
+        }
+        csv.append(1, '\n');
+
+        for (std::size_t row = 0; row < rows(); ++row) {
+            auto seconds = Seconds[pick(Seconds.size())];
+            csv.append(dateTime(row)).append(",heat,")
+                    .append(SystemModes[pick(SystemModes.size())]).append(",,")
+                    .append(Climates[pick(Climates.size())]).append(",78.0,68.5,")
+                    .append(tenths(60, 15)).append(1, ',')
+                    .append(std::to_string(30 + pick(30))).append(1, ',')
+                    .append(tenths(-20, 90)).append(1, ',')
+                    .append(std::to_string(pick(40))).append(",0,")
+                    .append(seconds).append(1, ',').append(seconds).append(1, ',')
+                    .append(pick(2) ? "1.5" : "").append(1, ',')
+                    .append(tenths(65, 10)).append(1, ',')
+                    .append(std::to_string(30 + pick(30))).append(1, ',')
+                    .append(std::to_string(pick(2))).append(1, ',')
+                    .append(std::to_string(100000 + pick(3000)));
+            for (unsigned sensor = 0; sensor < mOptions.sensors; ++sensor) {
+                // Remote sensors occasionally miss an interval.
+                csv.append(1, ',').append(pick(50) ? tenths(62, 12) : "")
+                        .append(1, ',').append(std::to_string(pick(2)));
+            }
+            csv.append(1, '\n');
+        }
+        return csv;
+    }
+
+    nlohmann::json Synthetic::runtimeReport() {
+        nlohmann::json report{};
+        report["columns"] = ReportColumns;
+        report["status"] = {{"code", 0}, {"message", ""}};
+
+        /**
+         * The thermostat is always present as temperature, humidity, occupancy and air pressure sensors.
+         */
+        nlohmann::json sensors = nlohmann::json::array();
+        nlohmann::json sensorColumns = {"date", "time"};
+        auto addSensor = [&](const std::string &id, const std::string &name, std::string_view type) {
+            sensors.push_back({{"sensorId", id}, {"sensorName", name}, {"sensorType", type},
+                               {"sensorUsage", "monitor"}});
+            sensorColumns.push_back(id);
+        };
+        addSensor("ei:0:1", "Thermostat Temperature", "temperature");
+        addSensor("ei:0:2", "Thermostat Humidity", "humidity");
+        addSensor("ei:0:3", "Thermostat Motion", "occupancy");
+        addSensor("ei:0:4", "Thermostat Air Pressure", "airPressure");
+        for (unsigned sensor = 0; sensor < mOptions.sensors; ++sensor) {
+            auto id = "rs:" + std::to_string(100 + sensor);
+            auto name = "Sensor " + std::to_string(sensor);
+            addSensor(id + ":1", name, "temperature");
+            addSensor(id + ":2", name + " Motion", "occupancy");
+        }
+
+        nlohmann::json rowList = nlohmann::json::array();
+        nlohmann::json sensorData = nlohmann::json::array();
+        for (std::size_t row = 0; row < rows(); ++row) {
+            auto time = dateTime(row);
+            auto heat = Seconds[pick(Seconds.size())];
+            auto cool = pick(4) ? std::string_view{"0"} : Seconds[pick(Seconds.size())];
+            std::string line{time};
+            line.append(",heat,").append(SystemModes[pick(SystemModes.size())]).append(1, ',')
+                    .append(Climates[pick(Climates.size())]).append(1, ',')
+                    .append(tenths(60, 15)).append(1, ',')
+                    .append(heat).append(1, ',').append(cool).append(1, ',').append(heat).append(",68.5,78.0,")
+                    .append(tenths(-20, 90)).append(1, ',')
+                    .append(std::to_string(40 + pick(60))).append(1, ',')
+                    .append(std::to_string(pick(40)));
+            rowList.push_back(std::move(line));
+
+            std::string data{time};
+            data.append(1, ',').append(tenths(65, 10))
+                    .append(1, ',').append(std::to_string(30 + pick(30)))
+                    .append(1, ',').append(std::to_string(pick(2)))
+                    .append(1, ',').append(std::to_string(100000 + pick(3000)));
+            for (unsigned sensor = 0; sensor < mOptions.sensors; ++sensor)
+                data.append(1, ',').append(tenths(62, 12)).append(1, ',').append(std::to_string(pick(2)));
+            sensorData.push_back(std::move(data));
+        }
+
+        report["reportList"] = nlohmann::json::array({{{"thermostatIdentifier", "000000000000"},
+                                                       {"rowCount", rows()},
+                                                       {"rowList", std::move(rowList)}}});
+        report["sensorList"] = nlohmann::json::array({{{"thermostatIdentifier", "000000000000"},
+                                                       {"sensors", std::move(sensors)},
+                                                       {"columns", std::move(sensorColumns)},
+                                                       {"data", std::move(sensorData)}}});
+        return report;
+    }
+} // ecoBee
@@ -0,0 +1,76 @@
+/**
+ * @file Synthetic.h
+ * @brief Deterministic synthetic ecoBee data for benchmarks.
+ * @details The same options always produce the same data on every platform, values are derived directly from
+ * a std::mt19937 rather than the implementation defined standard distributions.
+ */
+
+#ifndef ECOBEEDATA_SYNTHETIC_H
+#define ECOBEEDATA_SYNTHETIC_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace ecoBee {
+    /**
+     * @class Synthetic
+     * @brief Generate CSV exports and runtime reports with one row per 5 minute interval.
+     */
+    class Synthetic {
+    public:
+        static constexpr unsigned MaximumDays = 5 * 365 + 1;
+        static constexpr unsigned MaximumSensors = 32;
+        static constexpr unsigned RowsPerDay = 24 * 12;
+
+        struct Options {
+            unsigned days{30};              ///< The number of days of data, 1 to MaximumDays.
+            unsigned sensors{4};            ///< The number of remote sensors, 0 to MaximumSensors.
+            std::uint32_t seed{1};          ///< The random number seed.
+        };
+
+    private:
+        Options mOptions;
+        std::mt19937 mRandom;
+
+        /**
+         * @brief A value in [minimum, minimum + range) formatted with one decimal place.
+         */
+        std::string tenths(int minimum, unsigned range);
+
+        unsigned pick(unsigned range) {
+            return static_cast<unsigned>(mRandom() % range);
+        }
+
+        /**
+         * @brief The local date and time of a row as YYYY-MM-DD,HH:MM:SS.
+         */
+        [[nodiscard]] static std::string dateTime(std::size_t row);
+
+    public:
+        Synthetic() = delete;
+
+        /**
+         * @throws std::invalid_argument if the days or sensors are out of range.
+         */
+        explicit Synthetic(Options options);
+
+        [[nodiscard]] std::size_t rows() const {
+            return static_cast<std::size_t>(mOptions.days) * RowsPerDay;
+        }
+
+        /**
+         * @brief The text of a CSV export as downloaded from the ecoBee web portal.
+         */
+        std::string csvExport();
+
+        /**
+         * @brief A runtime report as returned by the ecoBee API for the DataColumns of ecoBeeApi.
+         */
+        nlohmann::json runtimeReport();
+    };
+} // ecoBee
+
+#endif //ECOBEEDATA_SYNTHETIC_H
@@ -0,0 +1,294 @@
+/**
+ * @file ecoBeeBench.cpp
+ * @brief Benchmarks of the parsing and encoding hot paths.
+ * @details Each benchmark is run over synthetic data and reports the rows processed per second and the heap
+ * bytes and allocations per row. The report archive round trip is also checked, and the exit status is non-zero
+ * if the replayed rows differ from those written directly. Options:
+ *  --days N     Days of data, one row per 5 minutes (default 30, up to 5 years).
+ *  --sensors N  Remote sensors (default 4, up to 32).
+ *  --seed N     Synthetic data seed (default 1).
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string_view>
+#include "InputParser.h"
+#include "ConfigFile.h"
+#include "Api.h"
+#include "RuntimeReportReader.h"
+#include "ReportArchive.h"
+#include "EcoBeeDataFile.h"
+#include "InfluxBatch.h"
+#include "SeriesKeys.h"
+#include "Synthetic.h"
+
+namespace {
+    std::atomic<std::size_t> allocatedBytes{0};
+    std::atomic<std::size_t> allocationCount{0};
+}
+
+void *operator new(std::size_t size) {
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size ? size : 1); ptr)
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+    /**
+     * @brief Time a benchmark and print its throughput and allocations.
+     * @details Standard output is suppressed while the benchmark runs so progress messages do not interfere.
+     * @param name The benchmark name.
+     * @param rows The number of rows the benchmark processes.
+     * @param benchmark The benchmark.
+     */
+    template<class Benchmark>
+    void run(std::string_view name, std::size_t rows, Benchmark &&benchmark) {
+        std::cout.flush();
+        std::cout.setstate(std::ios::failbit);
+        allocatedBytes = 0;
+        allocationCount = 0;
+        auto start = std::chrono::steady_clock::now();
+        benchmark();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        auto bytes = static_cast<double>(allocatedBytes.load());
+        auto count = static_cast<double>(allocationCount.load());
+        std::cout.clear();
+
+        auto rowCount = static_cast<double>(rows ? rows : 1);
+        std::cout << std::left << std::setw(20) << name << std::right
+                  << std::setw(10) << rows
+                  << std::setw(14) << std::fixed << std::setprecision(0) << rowCount / elapsed.count()
+                  << std::setw(12) << std::setprecision(1) << bytes / rowCount
+                  << std::setw(12) << std::setprecision(2) << count / rowCount << '\n';
+    }
+
+    /**
+     * A transport that only counts the bytes it would write.
+     */
+    InfluxBatch::Transport nullTransport(std::size_t &bytes) {
+        return [&bytes](const std::string &body) { bytes += body.size(); };
+    }
+}
+
+int main(int argc, char **argv) {
+    static constexpr std::string_view DaysOption = "--days";
+    static constexpr std::string_view SensorsOption = "--sensors";
+    static constexpr std::string_view SeedOption = "--seed";
+
+    InputParser inputParser{argc, argv};
+    ecoBee::Synthetic::Options options{};
+    bool roundTrip{true};
+
+    try {
+        if (inputParser.cmdOptionExists(DaysOption))
+            options.days = ConfigFile::safeConvert<unsigned>(inputParser.getCmdOption(DaysOption)).value_or(0);
+        if (inputParser.cmdOptionExists(SensorsOption))
+            options.sensors = ConfigFile::safeConvert<unsigned>(inputParser.getCmdOption(SensorsOption))
+                    .value_or(ecoBee::Synthetic::MaximumSensors + 1);
+        if (inputParser.cmdOptionExists(SeedOption))
+            options.seed = ConfigFile::safeConvert<std::uint32_t>(inputParser.getCmdOption(SeedOption)).value_or(1);
+
+        ecoBee::Synthetic synthetic{options};
+        auto rows = synthetic.rows();
+        auto csv = synthetic.csvExport();
+        auto report = synthetic.runtimeReport();
+
+        auto csvPath = std::filesystem::temp_directory_path() /
+                       ("ecoBeeBench-" + std::to_string(getpid()) + ".csv");
+        std::ofstream(csvPath, std::ios::binary) << csv;
+
+        std::cout << options.days << " days, " << options.sensors << " sensors, " << rows << " rows, "
+                  << csv.size() << " CSV bytes\n\n"
+                  << std::left << std::setw(20) << "benchmark" << std::right << std::setw(10) << "rows"
+                  << std::setw(14) << "rows/s" << std::setw(12) << "bytes/row" << std::setw(12) << "allocs/row"
+                  << '\n';
+
+        run("processDataFile", rows, [&]() {
+            EcoBeeDataFile dataFile{};
+            dataFile.processDataFile(csvPath);
+        });
+
+        run("mapDataFile", rows, [&]() {
+            EcoBeeDataFile dataFile{};
+            dataFile.mapDataFile(csvPath);
+        });
+
+        run("streamDataFile", rows, [&]() {
+            EcoBeeDataFile dataFile{};
+            std::size_t fields{0};
+            dataFile.streamDataFile(csvPath, [&fields](const EcoBeeDataFile::DataView &line) {
+                fields += line.size();
+            });
+        });
+
+        /**
+         * Escaping every header once per row, as each point was escaped before SeriesKeys.
+         */
+        std::vector<std::string> headers{};
+        auto headerLine = std::string_view{csv}.substr(csv.find('\n') + 1);
+        headerLine = headerLine.substr(0, headerLine.find('\n'));
+        for (auto header : ecoBee::Tokens{headerLine, ','})
+            headers.emplace_back(header);
+        run("escapeHeader", rows, [&]() {
+            std::size_t length{0};
+            for (std::size_t row = 0; row < rows; ++row)
+                for (const auto &header : headers)
+                    length += EcoBeeDataFile::escapeHeader(header).size();
+        });
+
+        std::vector<std::string> rowList{}, sensorList{};
+        for (const auto &row : report["reportList"][0]["rowList"])
+            rowList.push_back(row.get<std::string>());
+        for (const auto &row : report["sensorList"][0]["data"])
+            sensorList.push_back(row.get<std::string>());
+
+        run("Tokens", rows, [&]() {
+            std::vector<std::string_view> fields{};
+            std::size_t tokens{0};
+            for (std::size_t row = 0; row < rows; ++row) {
+                fields.clear();
+                for (auto field : ecoBee::Tokens{rowList[row], ','})
+                    fields.push_back(field);
+                for (auto field : ecoBee::Tokens{sensorList[row], ','})
+                    fields.push_back(field);
+                tokens += fields.size();
+            }
+        });
+
+        std::vector<std::vector<std::string>> reportRows{};
+        for (const auto &row : rowList) {
+            auto &fields = reportRows.emplace_back();
+            for (auto field : ecoBee::Tokens{row, ','})
+                fields.emplace_back(field);
+        }
+
+        run("localToGMT", rows, [&]() {
+            std::size_t length{0};
+            for (const auto &row : reportRows)
+                length += ecoBee::localToGMT(row[0], row[1]).size();
+        });
+
+        run("FtoC", rows, [&]() {
+            std::size_t length{0};
+            std::array<char, 64> buffer{};
+            for (const auto &row : reportRows) {
+                if (auto value = ecoBee::parseNumber(row[5]); value) {
+                    auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(),
+                                                ecoBee::FtoC(value.value()), std::chars_format::fixed, 2);
+                    length += static_cast<std::size_t>(result.ptr - buffer.data());
+                }
+            }
+        });
+
+        run("processRuntimeData", rows, [&]() {
+            std::size_t bytes{0};
+            InfluxBatch influx{nullTransport(bytes), {}};
+            std::string lastData{};
+            [[maybe_unused]] auto last = ecoBee::processRuntimeData(report, influx, lastData);
+        });
+
+        /**
+         * Parse and write the report text as it is streamed from the server, rather than from a document.
+         */
+        auto reportText = report.dump();
+        run("runtimeReportReader", rows, [&]() {
+            std::size_t bytes{0};
+            InfluxBatch influx{nullTransport(bytes), {}};
+            ecoBee::RuntimeReportReader reader{influx, {}};
+            std::istringstream stream{reportText};
+            reader.parse(stream);
+            reader.finish();
+        });
+
+        /**
+         * Archive the report, then check that replaying the archive writes exactly what the report wrote directly.
+         */
+        auto archivePath = std::filesystem::temp_directory_path() /
+                           ("ecoBeeBench-" + std::to_string(getpid()) + ".archive");
+        std::string direct{}, replayed{};
+        {
+            ecoBee::ReportWindow window{"bench"};
+            InfluxBatch influx{[&direct](const std::string &body) { direct += body; }, {}};
+            ecoBee::RuntimeReportReader reader{{ecoBee::RuntimeReportReader::Target{{}, "Home ", &influx, {}, &window}}};
+            std::istringstream stream{reportText};
+            reader.parse(stream);
+            reader.finish();
+            ecoBee::ReportArchive archive{archivePath};
+            archive.append(window);
+        }
+
+        ecoBee::ArchiveReader archiveReader{archivePath};
+        run("archiveReplay", rows, [&]() {
+            std::size_t bytes{0};
+            InfluxBatch influx{nullTransport(bytes), {}};
+            SeriesKeys seriesKeys{"Home "};
+            archiveReader.replay("bench", seriesKeys, influx);
+            influx.flush();
+        });
+
+        {
+            InfluxBatch influx{[&replayed](const std::string &body) { replayed += body; }, {}};
+            SeriesKeys seriesKeys{"Home "};
+            archiveReader.replay("bench", seriesKeys, influx);
+            influx.flush();
+        }
+        std::filesystem::remove(archivePath);
+
+        if (replayed != direct) {
+            auto diff = std::mismatch(direct.begin(), direct.end(), replayed.begin(), replayed.end());
+            std::cerr << "Archive round trip mismatch at byte " << (diff.first - direct.begin()) << " of "
+                      << direct.size() << " direct, " << replayed.size() << " replayed.\n";
+            roundTrip = false;
+        }
+
+        /**
+         * Encode every numeric column of the export to line protocol.
+         */
+        EcoBeeDataFile dataFile{};
+        std::cout.setstate(std::ios::failbit);
+        dataFile.mapDataFile(csvPath);
+        std::cout.clear();
+        run("lineProtocol", rows, [&]() {
+            std::size_t bytes{0};
+            InfluxBatch influx{nullTransport(bytes), {}};
+            SeriesKeys seriesKeys{"Home "};
+            for (const auto &line : dataFile.mappedRows()) {
+                influx.newMeasurements();
+                influx.setMeasurementEpoch(line[EcoBeeDataFile::Date], line[EcoBeeDataFile::Time]);
+                for (std::size_t idx = EcoBeeDataFile::CoolSetTemp; idx < line.size(); ++idx) {
+                    if (auto name = dataFile.getRawHeader(static_cast<EcoBeeDataFile::DataIndex>(idx)); name)
+                        influx.addPoint(seriesKeys.key(name.value()), line[idx]);
+                }
+                influx.pushData();
+            }
+            influx.flush();
+        });
+
+        std::filesystem::remove(csvPath);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return roundTrip ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file ecoBeeHarness.cpp
+ * @brief End to end throughput of the ecoBeeApi cycle against local stand-ins for the ecobee API and InfluxDB.
+ * @details The ecobee stand-in serves thermostatSummary, runtimeReport and token with synthetic data, the
+ * InfluxDB stand-in accepts /write and counts the points. Each cycle polls, requests a report and writes it
+ * through the same functions and HTTP client as ecoBeeApi, refreshing the token when it is refused. The
+ * rows per second and the 50th and 99th percentile cycle latency are reported. Options:
+ *  --cycles N    Cycles to run (default 50).
+ *  --days N      Days of data in each report, one row per 5 minutes (default 1).
+ *  --sensors N   Remote sensors (default 4, up to 32).
+ *  --latency N   Milliseconds each stand-in waits before it responds (default 0).
+ *  --errors N    Percent of requests that fail (default 0). The ecobee stand-in refuses the token, the
+ *                InfluxDB stand-in answers 500.
+ *  --seed N      Synthetic data and failure seed (default 1).
+ *  --gzip N      Gzip write requests at level N, 1 to 9 (default 0, uncompressed). The bytes received by the
+ *                InfluxDB stand-in and the bytes they inflate to are reported.
+ *  --sync        Write each batch as the report is parsed rather than on a writer thread.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+#include "InputParser.h"
+#include "ConfigFile.h"
+#include "Api.h"
+#include "RuntimeReportReader.h"
+#include "InfluxBatch.h"
+#include "AsyncWriter.h"
+#include "StandIn.h"
+#include "Synthetic.h"
+
+using json = nlohmann::json;
+
+namespace {
+    constexpr std::string_view TokenResponse = R"({"access_token":"harnessAccess","token_type":"Bearer",)"
+                                               R"("expires_in":3599,"refresh_token":"harnessRefresh",)"
+                                               R"("scope":"smartRead"})";
+
+    constexpr std::string_view ExpiredResponse = R"({"status":{"code":14,)"
+                                                 R"("message":"Authentication token has expired."}})";
+
+    /**
+     * @brief A thermostat summary whose runtime revision changes on every poll.
+     */
+    std::string summary(long revision) {
+        return ysh::StringComposite(R"({"thermostatCount":1,"revisionList":[")", ecoBee::Thermostat,
+                                    ":Home:true:1:1:", revision, R"(:1"],"status":{"code":0,"message":""}})");
+    }
+
+    /**
+     * @brief Inflate a gzip request body, a body that is not gzip is returned as it is.
+     */
+    std::string inflateBody(const std::string &body) {
+        if (body.size() < 2 || static_cast<unsigned char>(body[0]) != 0x1f ||
+            static_cast<unsigned char>(body[1]) != 0x8b)
+            return body;
+
+        z_stream stream{};
+        if (inflateInit2(&stream, 15 + 16) != Z_OK)
+            return {};
+        std::string text{};
+        std::array<char, 65536> buffer{};
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+        stream.avail_in = static_cast<uInt>(body.size());
+        int status{Z_OK};
+        while (status == Z_OK) {
+            stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+            stream.avail_out = static_cast<uInt>(buffer.size());
+            status = inflate(&stream, Z_NO_FLUSH);
+            text.append(buffer.data(), buffer.size() - stream.avail_out);
+        }
+        inflateEnd(&stream);
+        return status == Z_STREAM_END ? text : std::string{};
+    }
+
+    /**
+     * @brief The value at a percentile of sorted samples.
+     */
+    double percentile(const std::vector<double> &sorted, std::size_t percent) {
+        if (sorted.empty())
+            return 0.;
+        return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+    }
+}
+
+int main(int argc, char **argv) {
+    static constexpr std::string_view CyclesOption = "--cycles";
+    static constexpr std::string_view DaysOption = "--days";
+    static constexpr std::string_view SensorsOption = "--sensors";
+    static constexpr std::string_view LatencyOption = "--latency";
+    static constexpr std::string_view ErrorsOption = "--errors";
+    static constexpr std::string_view SeedOption = "--seed";
+    static constexpr std::string_view GzipOption = "--gzip";
+    static constexpr std::string_view SyncOption = "--sync";
+
+    InputParser inputParser{argc, argv};
+    ecoBee::Synthetic::Options options{1, 4, 1};
+    ecoBee::StandInServer::Options serverOptions{};
+    std::size_t cycles{50};
+    int gzipLevel{0};
+
+    try {
+        if (inputParser.cmdOptionExists(CyclesOption))
+            cycles = ConfigFile::safeConvert<std::size_t>(inputParser.getCmdOption(CyclesOption)).value_or(0);
+        if (inputParser.cmdOptionExists(DaysOption))
+            options.days = ConfigFile::safeConvert<unsigned>(inputParser.getCmdOption(DaysOption)).value_or(0);
+        if (inputParser.cmdOptionExists(SensorsOption))
+            options.sensors = ConfigFile::safeConvert<unsigned>(inputParser.getCmdOption(SensorsOption))
+                    .value_or(ecoBee::Synthetic::MaximumSensors + 1);
+        if (inputParser.cmdOptionExists(LatencyOption))
+            serverOptions.latency = std::chrono::milliseconds{
+                    ConfigFile::safeConvert<long>(inputParser.getCmdOption(LatencyOption)).value_or(0)};
+        if (inputParser.cmdOptionExists(ErrorsOption))
+            serverOptions.errorRate =
+                    ConfigFile::safeConvert<unsigned>(inputParser.getCmdOption(ErrorsOption)).value_or(0) / 100.;
+        if (inputParser.cmdOptionExists(SeedOption))
+            options.seed = serverOptions.seed =
+                    ConfigFile::safeConvert<std::uint32_t>(inputParser.getCmdOption(SeedOption)).value_or(1);
+        if (inputParser.cmdOptionExists(GzipOption))
+            gzipLevel = ConfigFile::safeConvert<int>(inputParser.getCmdOption(GzipOption)).value_or(0);
+
+        ecoBee::Synthetic synthetic{options};
+        auto rowsPerReport = synthetic.rows();
+        auto reportText = synthetic.runtimeReport().dump();
+
+        using Request = ecoBee::StandInServer::Request;
+        using Response = ecoBee::StandInServer::Response;
+
+        std::atomic<long> revision{0};
+        ecoBee::StandInServer ecoBeeServer{[&](const Request &request, bool fail) -> Response {
+            std::string_view target{request.target};
+            if (target.starts_with("/token"))
+                return {200, std::string{TokenResponse}};
+            if (fail)
+                return {500, std::string{ExpiredResponse}};
+            if (target.starts_with("/1/thermostatSummary"))
+                return {200, summary(++revision)};
+            if (target.starts_with("/1/runtimeReport"))
+                return {200, reportText};
+            return {404, {}};
+        }, serverOptions};
+
+        std::atomic<std::size_t> points{0}, bytesReceived{0}, bytesInflated{0};
+        ecoBee::StandInServer influxServer{[&](const Request &request, bool fail) -> Response {
+            if (fail)
+                return {500, R"({"error":"injected failure"})"};
+            if (!request.target.starts_with("/write"))
+                return {404, {}};
+            auto text = inflateBody(request.body);
+            bytesReceived += request.body.size();
+            bytesInflated += text.size();
+            points += static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+            return {204, {}, "text/plain"};
+        }, serverOptions};
+
+        ecoBee::setApiUrl(ecoBeeServer.url());
+        auto accessToken = json::parse(TokenResponse);
+        std::string token = accessToken["access_token"];
+        auto refresh = [&]() {
+            std::string refreshToken = accessToken["refresh_token"];
+            if (ecoBee::refreshAccessToken(accessToken, ecoBee::apiUrl() + "/token", "harness", refreshToken) !=
+                ecoBee::ApiStatus::OK)
+                throw ecoBee::ApiError("Can not refresh access token.");
+            token = accessToken["access_token"];
+        };
+
+        /**
+         * One ecoBeeApi cycle, the number of report rows written.
+         */
+        auto transport = InfluxBatch::httpTransport("127.0.0.1", false, influxServer.port(), "ecoBee", gzipLevel);
+        bool sync = inputParser.cmdOptionExists(SyncOption);
+        auto cycle = [&]() -> std::size_t {
+            json poll{};
+            if (ecoBee::statusPoll(poll, token) == ecoBee::ApiStatus::TokenExpired) {
+                refresh();
+                if (ecoBee::statusPoll(poll, token) != ecoBee::ApiStatus::OK)
+                    throw ecoBee::ApiError("API polling error.");
+            }
+
+            auto [startDate, start, endDate, end, now] = ecoBee::runtimeIntervals("2022-01-01T05:00:00Z");
+            auto url = ecoBee::runtimeReportUrl(std::array<std::string_view, 1>{"zoneAveTemp"}, true,
+                                                ecoBee::Thermostat, startDate, start, endDate, end);
+            for (bool retried = false;; retried = true) {
+                AsyncWriter writer{transport};
+                auto influx = sync ? std::make_unique<InfluxBatch>(transport, InfluxBatch::Limits{}) :
+                              std::make_unique<InfluxBatch>(writer, InfluxBatch::Limits{});
+                ecoBee::RuntimeReportReader reader{*influx, {}};
+                auto status = ecoBee::runtimeReport(reader, token, url);
+                if (status == ecoBee::ApiStatus::OK) {
+                    reader.finish();
+                    return rowsPerReport;
+                }
+                if (retried)
+                    throw ecoBee::ApiError("Runtime report refused.");
+                refresh();
+            }
+        };
+
+        std::vector<double> latencies{};
+        std::size_t rows{0}, failures{0};
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t idx = 0; idx < cycles; ++idx) {
+            auto cycleStart = std::chrono::steady_clock::now();
+            try {
+                rows += cycle();
+            } catch (const std::exception &) {
+                ++failures;
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - cycleStart;
+            latencies.push_back(elapsed.count());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << cycles << " cycles, " << rowsPerReport << " rows per report, " << options.sensors
+                  << " sensors, " << serverOptions.latency.count() << " ms latency, "
+                  << serverOptions.errorRate * 100. << "% errors, gzip level " << gzipLevel
+                  << (sync ? ", synchronous writes" : ", writer thread") << "\n\n"
+                  << std::fixed << std::setprecision(1)
+                  << std::left << std::setw(20) << "failed cycles" << failures << '\n'
+                  << std::setw(20) << "rows written" << rows << '\n'
+                  << std::setw(20) << "points received" << points.load() << '\n'
+                  << std::setw(20) << "write bytes" << bytesReceived.load() << '\n'
+                  << std::setw(20) << "line bytes" << bytesInflated.load() << '\n'
+                  << std::setw(20) << "requests" << ecoBeeServer.requests() + influxServer.requests() << '\n'
+                  << std::setw(20) << "rows/s" << static_cast<double>(rows) / elapsed.count() << '\n'
+                  << std::setw(20) << "p50 cycle ms" << percentile(latencies, 50) << '\n'
+                  << std::setw(20) << "p99 cycle ms" << percentile(latencies, 99) << '\n';
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file ChunkQueue.h
+ * @brief Hand a response body from the thread receiving it to a thread reading it as a stream.
+ * @details The receiving thread pushes each chunk as it arrives, the reading thread wraps the queue in a
+ * std::istream. At most a fixed number of chunks are held so a slow reader holds back the download instead
+ * of the body accumulating in memory.
+ */
+
+#ifndef ECOBEEDATA_CHUNKQUEUE_H
+#define ECOBEEDATA_CHUNKQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+
+namespace ecoBee {
+
+    /**
+     * @class ChunkQueue
+     */
+    class ChunkQueue : public std::streambuf {
+        std::mutex mMutex{};
+        std::condition_variable mChanged{};
+        std::deque<std::string> mChunks{};
+        std::string mCurrent{};         ///< The chunk being read.
+        std::size_t mLimit;             ///< The most chunks held.
+        bool mClosed{false};            ///< No more chunks will be pushed.
+        bool mAbandoned{false};         ///< No more chunks will be read.
+
+    protected:
+        int_type underflow() override {
+            std::unique_lock lock{mMutex};
+            mChanged.wait(lock, [this]() { return !mChunks.empty() || mClosed; });
+            if (mChunks.empty())
+                return traits_type::eof();
+
+            mCurrent = std::move(mChunks.front());
+            mChunks.pop_front();
+            mChanged.notify_all();
+            setg(mCurrent.data(), mCurrent.data(), mCurrent.data() + mCurrent.size());
+            return traits_type::to_int_type(*gptr());
+        }
+
+    public:
+        /**
+         * @param limit The most chunks held before push() waits.
+         */
+        explicit ChunkQueue(std::size_t limit = 64) : mLimit(limit ? limit : 1) {}
+
+        /**
+         * @brief Add a chunk, waiting while the queue is full. Empty chunks are ignored.
+         * @return False if the reader has abandoned the body.
+         */
+        bool push(const char *data, std::size_t size) {
+            std::unique_lock lock{mMutex};
+            mChanged.wait(lock, [this]() { return mChunks.size() < mLimit || mAbandoned; });
+            if (mAbandoned)
+                return false;
+            if (size) {
+                mChunks.emplace_back(data, size);
+                mChanged.notify_all();
+            }
+            return true;
+        }
+
+        /**
+         * @brief Mark the end of the body, the reader sees end of file once the queue is empty.
+         */
+        void close() {
+            std::lock_guard lock{mMutex};
+            mClosed = true;
+            mChanged.notify_all();
+        }
+
+        /**
+         * @brief Stop reading, a waiting or later push() returns false.
+         */
+        void abandon() {
+            std::lock_guard lock{mMutex};
+            mAbandoned = true;
+            mChunks.clear();
+            mChanged.notify_all();
+        }
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_CHUNKQUEUE_H
@@ -0,0 +1,52 @@
+/**
+ * @file GzipEncoder.cpp
+ */
+
+#include <memory>
+#include "GzipEncoder.h"
+
+namespace ecoBee {
+    namespace {
+        /**
+         * A window of 2^15 bytes with 16 added selects the gzip header and trailer.
+         */
+        constexpr int GzipWindowBits = 15 + 16;
+        constexpr int MemoryLevel = 8;
+    }
+
+    GzipEncoder::GzipEncoder(int level) : mLevel(level) {
+        if (deflateInit2(&mStream, mLevel, Z_DEFLATED, GzipWindowBits, MemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw GzipError(std::string{"Gzip init: "} + (mStream.msg ? mStream.msg : "invalid level"));
+    }
+
+    GzipEncoder::~GzipEncoder() {
+        deflateEnd(&mStream);
+    }
+
+    GzipEncoder &GzipEncoder::local(int level) {
+        thread_local std::unique_ptr<GzipEncoder> encoder{};
+        if (!encoder || encoder->level() != level)
+            encoder = std::make_unique<GzipEncoder>(level);
+        return *encoder;
+    }
+
+    std::string_view GzipEncoder::encode(std::string_view data) {
+        if (deflateReset(&mStream) != Z_OK)
+            throw GzipError("Gzip reset failed.");
+
+        // The bound is a single deflate call's worst case, the body is compressed without growing the buffer.
+        auto bound = deflateBound(&mStream, static_cast<uLong>(data.size()));
+        if (mBuffer.size() < bound)
+            mBuffer.resize(bound);
+
+        mStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        mStream.avail_in = static_cast<uInt>(data.size());
+        mStream.next_out = reinterpret_cast<Bytef *>(mBuffer.data());
+        mStream.avail_out = static_cast<uInt>(mBuffer.size());
+        if (auto status = deflate(&mStream, Z_FINISH); status != Z_STREAM_END)
+            throw GzipError(std::string{"Gzip deflate: "} + (mStream.msg ? mStream.msg : std::to_string(status)));
+
+        return std::string_view{mBuffer.data(), static_cast<std::size_t>(mStream.total_out)};
+    }
+
+} // ecoBee
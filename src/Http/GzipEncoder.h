@@ -0,0 +1,66 @@
+/**
+ * @file GzipEncoder.h
+ * @brief Gzip request bodies with a compressor kept between requests.
+ * @details The deflate state and output buffer are allocated once and reset for each body, so compressing a
+ * batch costs no allocation once the buffer has grown to the batch size. Line protocol repeats the same
+ * series keys on every row and compresses to a small fraction of its size.
+ */
+
+#ifndef ECOBEEDATA_GZIPENCODER_H
+#define ECOBEEDATA_GZIPENCODER_H
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <zlib.h>
+
+namespace ecoBee {
+
+    class GzipError : public std::runtime_error {
+    public:
+        explicit GzipError(const std::string& what_arg) : std::runtime_error(what_arg) {}
+    };
+
+    /**
+     * @class GzipEncoder
+     */
+    class GzipEncoder {
+        z_stream mStream{};
+        int mLevel;
+        std::string mBuffer{};
+
+    public:
+        static constexpr int MaximumLevel = Z_BEST_COMPRESSION;
+
+        GzipEncoder() = delete;
+        GzipEncoder(const GzipEncoder &) = delete;
+        GzipEncoder &operator=(const GzipEncoder &) = delete;
+
+        /**
+         * @param level The compression level, 1 (fastest) to 9 (smallest).
+         * @throws GzipError if the compressor can not be initialized.
+         */
+        explicit GzipEncoder(int level);
+
+        ~GzipEncoder();
+
+        /**
+         * @brief The calling thread's encoder, its level is changed if it differs.
+         */
+        static GzipEncoder &local(int level);
+
+        [[nodiscard]] int level() const {
+            return mLevel;
+        }
+
+        /**
+         * @brief Compress a body into a gzip member.
+         * @return The compressed body, valid until the next call.
+         * @throws GzipError if the body can not be compressed.
+         */
+        std::string_view encode(std::string_view data);
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_GZIPENCODER_H
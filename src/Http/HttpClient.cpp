@@ -0,0 +1,125 @@
+/**
+ * @file HttpClient.cpp
+ */
+
+#include <memory>
+#include "HttpClient.h"
+#include "StringComposite.h"
+
+namespace ecoBee {
+
+    void HttpHeaders::append(std::string_view header) {
+        auto list = curl_slist_append(mList, std::string{header}.c_str());
+        if (!list)
+            throw HttpError("Can not allocate HTTP header.");
+        mList = list;
+    }
+
+    HttpClient::HttpClient() {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        mShare = curl_share_init();
+        if (!mShare)
+            throw HttpError("Can not create HTTP share handle.");
+
+        curl_share_setopt(mShare, CURLSHOPT_LOCKFUNC, &HttpClient::lock);
+        curl_share_setopt(mShare, CURLSHOPT_UNLOCKFUNC, &HttpClient::unlock);
+        curl_share_setopt(mShare, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+
+    HttpClient::~HttpClient() {
+        curl_share_cleanup(mShare);
+        curl_global_cleanup();
+    }
+
+    HttpClient &HttpClient::shared() {
+        static HttpClient client{};
+        return client;
+    }
+
+    void HttpClient::lock(CURL *, curl_lock_data data, curl_lock_access, void *client) {
+        static_cast<HttpClient *>(client)->mLocks.at(static_cast<std::size_t>(data)).lock();
+    }
+
+    void HttpClient::unlock(CURL *, curl_lock_data data, void *client) {
+        static_cast<HttpClient *>(client)->mLocks.at(static_cast<std::size_t>(data)).unlock();
+    }
+
+    size_t HttpClient::write(char *data, size_t size, size_t count, void *sink) {
+        auto &receiver = *static_cast<const Sink *>(sink);
+        return receiver(std::string_view{data, size * count}) ? size * count : 0;
+    }
+
+    CURL *HttpClient::handle() {
+        // Thread local handles are destroyed before the shared client, so the share is never in use when
+        // it is cleaned up.
+        thread_local std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> easy{curl_easy_init(), &curl_easy_cleanup};
+        if (!easy)
+            throw HttpError("Can not create HTTP handle.");
+
+        // A reset keeps the handle's connections and caches but clears the options of the last request.
+        auto curl = easy.get();
+        curl_easy_reset(curl);
+        curl_easy_setopt(curl, CURLOPT_SHARE, mShare);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+        curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, 330L);     // Idle across a five minute poll interval.
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 0L);
+        // A stalled connection fails the request rather than blocking its thread. There is no total timeout, a
+        // long report streams for as long as data keeps arriving.
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, ConnectTimeout);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, LowSpeedLimit);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, LowSpeedTime);
+        return curl;
+    }
+
+    long HttpClient::perform(CURL *curl, const std::string &url, const Sink &sink) {
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &HttpClient::write);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+
+        if (auto result = curl_easy_perform(curl); result != CURLE_OK)
+            throw HttpError(ysh::StringComposite("HTTP request failed: ", curl_easy_strerror(result)));
+
+        long code{0};
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+        return code;
+    }
+
+    long HttpClient::get(const std::string &url, const HttpHeaders &headers, const Sink &sink) {
+        auto curl = handle();
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.list());
+        return perform(curl, url, sink);
+    }
+
+    long HttpClient::get(const std::string &url, const HttpHeaders &headers, std::string &body) {
+        return get(url, headers, [&body](std::string_view data) {
+            body.append(data);
+            return true;
+        });
+    }
+
+    long HttpClient::post(const std::string &url, const HttpHeaders &headers, std::string_view data,
+                          const Sink &sink) {
+        auto curl = handle();
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.list());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.data());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(data.size()));
+        return perform(curl, url, sink);
+    }
+
+    long HttpClient::post(const std::string &url, const HttpHeaders &headers, std::string_view data,
+                          std::string &body) {
+        return post(url, headers, data, [&body](std::string_view received) {
+            body.append(received);
+            return true;
+        });
+    }
+
+} // ecoBee
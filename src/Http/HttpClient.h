@@ -0,0 +1,154 @@
+/**
+ * @file HttpClient.h
+ * @brief A process wide HTTP client that keeps connections, DNS lookups and TLS sessions between requests.
+ * @details Every request made through HttpClient::shared() uses a libcurl share handle holding the DNS cache,
+ * the TLS session cache and the connection pool, so a request to a host already visited skips the lookup and
+ * the TCP and TLS handshakes. Each thread keeps its own easy handle which is reset, not rebuilt, between
+ * requests. HTTP/2 is used where the server offers it over TLS. A request fails with HttpError if it can not
+ * connect within ConnectTimeout seconds, or if less than LowSpeedLimit bytes a second are transferred for
+ * LowSpeedTime seconds.
+ */
+
+#ifndef ECOBEEDATA_HTTPCLIENT_H
+#define ECOBEEDATA_HTTPCLIENT_H
+
+#include <array>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <curl/curl.h>
+
+namespace ecoBee {
+
+    class HttpError : public std::runtime_error {
+    public:
+        explicit HttpError(const std::string& what_arg) : std::runtime_error(what_arg) {}
+    };
+
+    /**
+     * @class HttpHeaders
+     * @brief A request header list built once and used for any number of requests.
+     */
+    class HttpHeaders {
+        curl_slist *mList{nullptr};
+
+    public:
+        HttpHeaders() = default;
+        HttpHeaders(const HttpHeaders &) = delete;
+        HttpHeaders &operator=(const HttpHeaders &) = delete;
+
+        HttpHeaders(std::initializer_list<std::string_view> headers) {
+            for (auto header : headers)
+                append(header);
+        }
+
+        HttpHeaders(HttpHeaders &&other) noexcept : mList(other.mList) {
+            other.mList = nullptr;
+        }
+
+        HttpHeaders &operator=(HttpHeaders &&other) noexcept {
+            std::swap(mList, other.mList);
+            return *this;
+        }
+
+        ~HttpHeaders() {
+            curl_slist_free_all(mList);
+        }
+
+        /**
+         * @brief Add a header line, "Name: value".
+         */
+        void append(std::string_view header);
+
+        [[nodiscard]] curl_slist *list() const {
+            return mList;
+        }
+    };
+
+    /**
+     * @class HttpClient
+     */
+    class HttpClient {
+    public:
+        /**
+         * Receives the response body as it arrives, returning false aborts the transfer.
+         */
+        using Sink = std::function<bool(std::string_view data)>;
+
+        static constexpr long ConnectTimeout = 30;  ///< Seconds to connect, including the TLS handshake.
+        static constexpr long LowSpeedLimit = 1;    ///< Bytes a second below which a transfer is stalled.
+        static constexpr long LowSpeedTime = 120;   ///< Seconds a transfer may be stalled before it fails.
+
+    private:
+        CURLSH *mShare;
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> mLocks{};
+
+        HttpClient();
+
+        static void lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *client);
+
+        static void unlock(CURL *handle, curl_lock_data data, void *client);
+
+        static size_t write(char *data, size_t size, size_t count, void *sink);
+
+        /**
+         * @brief The calling thread's easy handle, reset and attached to the share handle.
+         */
+        CURL *handle();
+
+        /**
+         * @brief Perform a prepared request.
+         * @return The HTTP response code.
+         * @throws HttpError if the transfer failed.
+         */
+        long perform(CURL *curl, const std::string &url, const Sink &sink);
+
+    public:
+        HttpClient(const HttpClient &) = delete;
+        HttpClient &operator=(const HttpClient &) = delete;
+
+        ~HttpClient();
+
+        /**
+         * @brief The client shared by every request of the process.
+         */
+        static HttpClient &shared();
+
+        /**
+         * @brief Make a GET request.
+         * @param url The request URL.
+         * @param headers The request headers.
+         * @param sink Receives the response body.
+         * @return The HTTP response code.
+         * @throws HttpError if the transfer failed.
+         */
+        long get(const std::string &url, const HttpHeaders &headers, const Sink &sink);
+
+        /**
+         * @brief Make a GET request, collecting the response body.
+         */
+        long get(const std::string &url, const HttpHeaders &headers, std::string &body);
+
+        /**
+         * @brief Make a POST request.
+         * @param url The request URL.
+         * @param headers The request headers.
+         * @param data The request body, it must remain valid until the request returns.
+         * @param sink Receives the response body.
+         * @return The HTTP response code.
+         * @throws HttpError if the transfer failed.
+         */
+        long post(const std::string &url, const HttpHeaders &headers, std::string_view data, const Sink &sink);
+
+        /**
+         * @brief Make a POST request, collecting the response body.
+         */
+        long post(const std::string &url, const HttpHeaders &headers, std::string_view data, std::string &body);
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_HTTPCLIENT_H
@@ -0,0 +1,103 @@
+/**
+ * @file AsyncWriter.cpp
+ */
+
+#include <bit>
+#include "AsyncWriter.h"
+
+AsyncWriter::AsyncWriter(InfluxBatch::Transport transport, std::size_t capacity)
+        : mTransport(std::move(transport)), mCapacity(std::bit_ceil(capacity ? capacity : 1)),
+          mSlots(std::make_unique<Slot[]>(mCapacity)) {
+    for (std::size_t idx = 0; idx < mCapacity; ++idx)
+        mSlots[idx].sequence.store(idx, std::memory_order_relaxed);
+    mWriter = std::jthread{[this]() { write(); }};
+}
+
+AsyncWriter::~AsyncWriter() {
+    enqueue({}, true);
+    if (mWriter.joinable())
+        mWriter.join();
+}
+
+AsyncWriter::Ticket AsyncWriter::enqueue(std::string_view body, bool stop) {
+    auto position = mTail.load(std::memory_order_relaxed);
+    for (;;) {
+        auto &slot = mSlots[position & (mCapacity - 1)];
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        auto lead = static_cast<std::int64_t>(sequence - position);
+        if (lead == 0) {
+            if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        } else if (lead < 0) {
+            // The ring is full, wait for the writer to free the slot.
+            slot.sequence.wait(sequence, std::memory_order_acquire);
+            position = mTail.load(std::memory_order_relaxed);
+        } else {
+            position = mTail.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto &slot = mSlots[position & (mCapacity - 1)];
+    slot.body.assign(body);
+    slot.stop = stop;
+    slot.sequence.store(position + 1, std::memory_order_release);
+    slot.sequence.notify_all();
+    return position + 1;
+}
+
+void AsyncWriter::write() {
+    for (std::uint64_t position = 0;; ++position) {
+        auto &slot = mSlots[position & (mCapacity - 1)];
+        for (auto sequence = slot.sequence.load(std::memory_order_acquire); sequence != position + 1;
+             sequence = slot.sequence.load(std::memory_order_acquire))
+            slot.sequence.wait(sequence, std::memory_order_acquire);
+
+        auto stop = slot.stop;
+        if (!stop && !mFailed.load(std::memory_order_relaxed)) {
+            try {
+                mTransport(slot.body);
+            } catch (...) {
+                std::lock_guard lock{mFailureMutex};
+                mFailure = std::current_exception();
+                mFailed.store(true, std::memory_order_release);
+            }
+        }
+
+        // The failure is published before the position, a waiter that sees the position sees the failure.
+        slot.sequence.store(position + mCapacity, std::memory_order_release);
+        slot.sequence.notify_all();
+        mWritten.store(position + 1, std::memory_order_release);
+        mWritten.notify_all();
+        if (stop)
+            return;
+    }
+}
+
+void AsyncWriter::throwIfFailed() {
+    if (mFailed.load(std::memory_order_acquire)) {
+        std::lock_guard lock{mFailureMutex};
+        std::rethrow_exception(mFailure);
+    }
+}
+
+AsyncWriter::Ticket AsyncWriter::push(std::string_view body) {
+    throwIfFailed();
+    return enqueue(body, false);
+}
+
+bool AsyncWriter::written(Ticket ticket) {
+    auto reached = mWritten.load(std::memory_order_acquire) >= ticket;
+    throwIfFailed();
+    return reached;
+}
+
+void AsyncWriter::wait(Ticket ticket) {
+    for (auto reached = mWritten.load(std::memory_order_acquire); reached < ticket;
+         reached = mWritten.load(std::memory_order_acquire))
+        mWritten.wait(reached, std::memory_order_acquire);
+    throwIfFailed();
+}
+
+void AsyncWriter::drain() {
+    wait(mTail.load(std::memory_order_acquire));
+}
@@ -0,0 +1,109 @@
+/**
+ * @file AsyncWriter.h
+ * @brief Write line protocol batches on a thread of their own so parsing and writing overlap.
+ * @details Batches are copied into a bounded ring of slots by any number of producer threads and written in
+ * order by one writer thread. Slots are claimed and published with atomic sequence numbers, no lock is taken
+ * on the way in or out. When every slot is full a producer waits for the writer to free one, so a slow
+ * database or disk holds back parsing rather than points being dropped or memory growing. Each slot keeps
+ * its buffer, once the ring has warmed up queuing a batch does not allocate.
+ *
+ * Each batch is given a ticket when it is queued. wait() is the barrier a caller uses before recording that
+ * data has been written: it returns once every batch up to the ticket has been written. The first write that
+ * fails stops the writer, later batches are discarded and every later push(), written() and wait() throws
+ * its exception. A writer is meant to last for one unit of work whose progress is only recorded if it succeeds.
+ */
+
+#ifndef ECOBEEDATA_ASYNCWRITER_H
+#define ECOBEEDATA_ASYNCWRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "InfluxBatch.h"
+
+/**
+ * @class AsyncWriter
+ */
+class AsyncWriter {
+public:
+    static constexpr std::size_t DefaultCapacity = 8;
+
+    using Ticket = std::uint64_t;
+
+private:
+    /**
+     * A slot at ring position p is free for position p when its sequence is p, and holds the batch of
+     * position p when its sequence is p + 1. The writer frees it for position p + capacity.
+     */
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        std::string body{};
+        bool stop{false};               ///< The writer thread ends at this slot.
+    };
+
+    InfluxBatch::Transport mTransport;
+    std::size_t mCapacity;
+    std::unique_ptr<Slot[]> mSlots;
+
+    alignas(64) std::atomic<std::uint64_t> mTail{0};       ///< The next position to claim.
+    alignas(64) std::atomic<std::uint64_t> mWritten{0};    ///< The positions written, or discarded after a failure.
+    std::atomic<bool> mFailed{false};
+
+    std::mutex mFailureMutex{};
+    std::exception_ptr mFailure{};
+    std::jthread mWriter{};             ///< Started once the slots are ready.
+
+    Ticket enqueue(std::string_view body, bool stop);
+
+    void write();
+
+    void throwIfFailed();
+
+public:
+    AsyncWriter() = delete;
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    /**
+     * @param transport Writes each batch, it is only called from the writer thread.
+     * @param capacity The most batches queued, rounded up to a power of two.
+     */
+    explicit AsyncWriter(InfluxBatch::Transport transport, std::size_t capacity = DefaultCapacity);
+
+    /**
+     * @brief Write the batches already queued and stop the writer thread.
+     */
+    ~AsyncWriter();
+
+    /**
+     * @brief Queue a batch, waiting while the ring is full.
+     * @return The batch's ticket.
+     * @throws The exception of a failed write.
+     */
+    Ticket push(std::string_view body);
+
+    /**
+     * @brief Check, without waiting, if every batch up to a ticket has been written.
+     * @throws The exception of a failed write.
+     */
+    bool written(Ticket ticket);
+
+    /**
+     * @brief Wait until every batch up to a ticket has been written.
+     * @throws The exception of a failed write.
+     */
+    void wait(Ticket ticket);
+
+    /**
+     * @brief Wait until every batch queued before the call has been written.
+     * @throws The exception of a failed write.
+     */
+    void drain();
+};
+
+#endif //ECOBEEDATA_ASYNCWRITER_H
@@ -0,0 +1,256 @@
+/**
+ * @file InfluxBatch.cpp
+ */
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include "InfluxBatch.h"
+#include "AsyncWriter.h"
+#include "Rollup.h"
+#include "HttpClient.h"
+#include "GzipEncoder.h"
+#include "StringComposite.h"
+
+InfluxBatch::InfluxBatch(const std::string &host, bool tls, long port, const std::string &db, Limits limits)
+        : InfluxBatch(httpTransport(host, tls, port, db), limits) {}
+
+InfluxBatch::Transport InfluxBatch::httpTransport(const std::string &host, bool tls, long port, const std::string &db,
+                                                  int gzipLevel) {
+    auto url = ysh::StringComposite((tls ? "https://" : "http://"), host, ':', port, "/write?db=", db);
+    auto headers = std::make_shared<ecoBee::HttpHeaders>(ecoBee::HttpHeaders{
+            "Content-Type: text/plain; charset=utf-8"});
+    if (gzipLevel > 0)
+        headers->append("Content-Encoding: gzip");
+    return [url, headers, gzipLevel](const std::string &body) {
+        // Each thread compresses with its own encoder, kept from one batch to the next.
+        std::string_view data{body};
+        if (gzipLevel > 0)
+            data = ecoBee::GzipEncoder::local(gzipLevel).encode(body);
+
+        std::string response{};
+        if (auto code = ecoBee::HttpClient::shared().post(url, *headers, data, response); code != 204) {
+            auto what = ysh::StringComposite("InfluxDB write error code: ", code, ' ', response);
+            if (code >= 400 && code < 500 && code != 429)
+                throw InfluxRejected(what);
+            throw InfluxError(what);
+        }
+    };
+}
+
+InfluxBatch::InfluxBatch(Transport transport, Limits limits) : mTransport(std::move(transport)), mLimits(limits) {}
+
+InfluxBatch::InfluxBatch(AsyncWriter &writer, Limits limits) : mWriter(&writer), mLimits(limits) {}
+
+InfluxBatch::~InfluxBatch() {
+    try {
+        flush();
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+void InfluxBatch::newMeasurements() {
+    mMeasurements.clear();
+    mMeasurementCount = 0;
+    mPendingStates.clear();
+    mPendingRollup.clear();
+}
+
+void InfluxBatch::setMeasurementEpoch(std::string_view date, std::string_view time) {
+    mMeasurementEpoch = localEpoch(date, time);
+}
+
+InfluxBatch::Epoch InfluxBatch::localEpoch(std::string_view date, std::string_view time) {
+    std::string dateTimeString{date};
+    dateTimeString.append(" ").append(time);
+
+    std::tm dateTime{};
+    strptime(dateTimeString.c_str(), "%Y-%m-%d %H:%M:%S", &dateTime);
+    dateTime.tm_isdst = -1;     // Let mktime work out if DST was in effect.
+    auto epoch = ::mktime(&dateTime);
+    return static_cast<Epoch>(epoch) * 1000000000ULL;
+}
+
+void InfluxBatch::appendPoint(const std::string &seriesKey, std::string_view value, Epoch timestamp) {
+    std::array<char, 24> buffer{};
+    auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), timestamp ? timestamp : mMeasurementEpoch);
+    mMeasurements.append(seriesKey).append(" value=").append(value)
+            .append(" ").append(buffer.data(), result.ptr).append("\n");
+    ++mMeasurementCount;
+}
+
+bool InfluxBatch::addPoint(const std::string &seriesKey, std::optional<std::string_view> value, Epoch timestamp) {
+    if (!value.has_value() || value.value().empty())
+        return false;
+    appendPoint(seriesKey, value.value(), timestamp);
+
+    if (mRollup) {
+        auto text = value.value();
+        double number{};
+        if (auto result = std::from_chars(text.data(), text.data() + text.size(), number);
+                result.ec == std::errc{} && result.ptr == text.data() + text.size())
+            mPendingRollup.push_back(RollupValue{RollupValue::Kind::Sample, &seriesKey, number, 0.,
+                                                 timestamp ? timestamp : mMeasurementEpoch});
+    }
+    return true;
+}
+
+template<typename Number>
+std::string_view InfluxBatch::formatNumber(Number value, std::array<char, 64> &buffer) const {
+    if (!std::isfinite(value))
+        return {};
+
+    auto result = mLimits.precision < 0
+                  ? std::to_chars(buffer.data(), buffer.data() + buffer.size(), value)
+                  : std::to_chars(buffer.data(), buffer.data() + buffer.size(), value, std::chars_format::fixed,
+                                  mLimits.precision);
+    if (result.ec != std::errc{})
+        return {};
+    return std::string_view{buffer.data(), static_cast<std::size_t>(result.ptr - buffer.data())};
+}
+
+bool InfluxBatch::addPoint(const std::string &seriesKey, float value, Epoch timestamp) {
+    std::array<char, 64> buffer{};
+    return addPoint(seriesKey, formatNumber(value, buffer), timestamp);
+}
+
+bool InfluxBatch::addPoint(const std::string &seriesKey, double value, Epoch timestamp) {
+    std::array<char, 64> buffer{};
+    return addPoint(seriesKey, formatNumber(value, buffer), timestamp);
+}
+
+bool InfluxBatch::addState(const std::string &seriesKey, std::string_view value, Epoch timestamp) {
+    if (value.empty())
+        return false;
+    if (mLimits.stateKeyframe.count() <= 0) {
+        appendPoint(seriesKey, value, timestamp);
+        return true;
+    }
+
+    auto time = timestamp ? timestamp : mMeasurementEpoch;
+    auto state = mStates.find(seriesKey);
+    if (state == mStates.end())
+        state = mStates.emplace(seriesKey, State{}).first;
+    auto &last = state->second;
+    auto keyframe = static_cast<Epoch>(std::chrono::nanoseconds{mLimits.stateKeyframe}.count());
+    if (last.value == value && time >= last.time && time - last.time < keyframe)
+        return true;
+
+    mPendingStates.emplace_back(&last, State{std::string{value}, time});
+    appendPoint(seriesKey, value, timestamp);
+    return true;
+}
+
+bool InfluxBatch::addState(const std::string &seriesKey, double value, Epoch timestamp) {
+    std::array<char, 64> buffer{};
+    return addState(seriesKey, formatNumber(value, buffer), timestamp);
+}
+
+void InfluxBatch::setRollup(Rollup *rollup) {
+    mRollup = rollup;
+    if (mRollup)
+        mRollup->setPrecision(mLimits.precision);
+}
+
+void InfluxBatch::addRuntime(const std::string &seriesKey, double seconds, double interval, Epoch timestamp) {
+    if (mRollup)
+        mPendingRollup.push_back(RollupValue{RollupValue::Kind::Runtime, &seriesKey, seconds, interval,
+                                             timestamp ? timestamp : mMeasurementEpoch});
+}
+
+void InfluxBatch::addDegrees(const std::string &seriesKey, double temperature, double interval, Epoch timestamp) {
+    if (mRollup && std::isfinite(temperature))
+        mPendingRollup.push_back(RollupValue{RollupValue::Kind::Degrees, &seriesKey, temperature, interval,
+                                             timestamp ? timestamp : mMeasurementEpoch});
+}
+
+void InfluxBatch::pushData() {
+    // Periods completed by the measurement set are written with it.
+    if (mRollup) {
+        for (const auto &value : mPendingRollup) {
+            switch (value.kind) {
+                case RollupValue::Kind::Sample:
+                    mRollup->sample(*value.seriesKey, value.value, value.time);
+                    break;
+                case RollupValue::Kind::Runtime:
+                    mRollup->runtime(*value.seriesKey, value.value, value.interval, value.time);
+                    break;
+                case RollupValue::Kind::Degrees:
+                    mRollup->degrees(*value.seriesKey, value.value, value.interval, value.time);
+                    break;
+            }
+        }
+        mRollupOpen |= !mPendingRollup.empty();
+        mPendingRollup.clear();
+        mMeasurementCount += mRollup->takeCompleted(mMeasurements);
+    }
+
+    if (mMeasurementCount == 0)
+        return;
+
+    if (mBatchCount == 0)
+        mBatchStart = std::chrono::steady_clock::now();
+    mBatch.append(mMeasurements);
+    mBatchCount += mMeasurementCount;
+    for (auto &[state, written] : mPendingStates)
+        *state = std::move(written);
+    newMeasurements();
+
+    if (mBatchCount >= mLimits.maxPoints || mBatch.size() >= mLimits.maxBytes)
+        write();
+    else
+        flushIfDue();
+    collect();
+}
+
+void InfluxBatch::discardData() {
+    mMeasurements.clear();
+    mMeasurementCount = 0;
+    mPendingStates.clear();
+    pushData();
+}
+
+void InfluxBatch::flushIfDue() {
+    if (mBatchCount > 0 && std::chrono::steady_clock::now() - mBatchStart >= mLimits.maxAge)
+        write();
+}
+
+void InfluxBatch::write() {
+    if (mBatchCount == 0)
+        return;
+
+    if (mWriter) {
+        mTickets.push_back(mWriter->push(mBatch));
+    } else {
+        mTransport(mBatch);
+        ++mRequestCount;
+    }
+    ++mQueuedCount;
+    mBatch.clear();
+    mBatchCount = 0;
+}
+
+void InfluxBatch::collect() {
+    while (!mTickets.empty() && mWriter->written(mTickets.front())) {
+        mTickets.pop_front();
+        ++mRequestCount;
+    }
+}
+
+void InfluxBatch::flush() {
+    // An open period is written again with the same time stamp each time it changes, the last write holds it all.
+    if (mRollup && mRollupOpen) {
+        mBatchCount += mRollup->appendOpen(mBatch);
+        mRollupOpen = false;
+    }
+    write();
+    if (!mTickets.empty()) {
+        mWriter->wait(mTickets.back());
+        collect();
+    }
+}
@@ -0,0 +1,341 @@
+/**
+ * @file InfluxBatch.h
+ * @brief Gather InfluxDB line protocol points across measurement sets and write them in batches.
+ * @details InfluxBatch follows the measurement set interface of InfluxPush, but points are added by series key
+ * (see SeriesKeys) and pushData() only moves the current measurement set into a batch. The batch is written in a
+ * single request when it reaches a point count or byte size limit, when a measurement set is pushed after its
+ * oldest point reached an age limit, or when flush() is called. There is no timer, points wait past the age limit
+ * while no measurement set is pushed.
+ * With an AsyncWriter batches reaching a limit are queued and written on the writer's thread, only flush()
+ * waits for them to be written.
+ *
+ * State and set point series rarely change. With a state keyframe interval they are added with addState(),
+ * which only writes a point when the value differs from the last one written for the series, or when the
+ * keyframe interval has passed since it. Queries fill the rows between with fill(previous).
+ *
+ * With a Rollup the numeric points, runtimes and outdoor temperatures of each pushed measurement set are also
+ * accumulated into hourly and daily aggregates, which are written with the batch as their periods complete
+ * and when it is flushed.
+ */
+
+#ifndef ECOBEEDATA_INFLUXBATCH_H
+#define ECOBEEDATA_INFLUXBATCH_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class InfluxError : public std::runtime_error {
+public:
+    explicit InfluxError(const std::string& what_arg) : std::runtime_error(what_arg) {}
+};
+
+/**
+ * The database refused a batch and will refuse it again, for example for a field type conflict.
+ */
+class InfluxRejected : public InfluxError {
+public:
+    explicit InfluxRejected(const std::string& what_arg) : InfluxError(what_arg) {}
+};
+
+class AsyncWriter;
+class Rollup;
+
+/**
+ * @class InfluxBatch
+ */
+class InfluxBatch {
+public:
+    using Epoch = unsigned long long;   ///< Nanoseconds since the Unix epoch.
+
+    /**
+     * The limits at which a batch is written, the precision numeric values are written with, and how often an
+     * unchanged state is written.
+     */
+    struct Limits {
+        std::size_t maxPoints{5000};            ///< Maximum number of points in a batch.
+        std::size_t maxBytes{1024 * 1024};      ///< Maximum size of a batch in bytes.
+        std::chrono::seconds maxAge{10};        ///< Age of the oldest point checked when a set is pushed.
+        int precision{2};                       ///< Digits after the decimal point, -1 for the shortest form.
+        std::chrono::seconds stateKeyframe{0};  ///< Longest time between state points, 0 writes every one.
+    };
+
+    /**
+     * The last point written to a state series.
+     */
+    struct State {
+        std::string value{};
+        Epoch time{0};
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const noexcept {
+            return std::hash<std::string_view>{}(key);
+        }
+    };
+
+    /**
+     * The last point written to each state series by series key.
+     */
+    using States = std::unordered_map<std::string, State, KeyHash, std::equal_to<>>;
+
+    /**
+     * A transport writes one batch of line protocol, it throws if the batch was not accepted. It throws
+     * InfluxRejected if writing the batch again can not succeed.
+     */
+    using Transport = std::function<void(const std::string &body)>;
+
+    static constexpr double DefaultInterval = 300.;     ///< The seconds between report rows.
+
+private:
+    /**
+     * A value of the measurement set for the rollup, accumulated when the set is pushed.
+     */
+    struct RollupValue {
+        enum class Kind {
+            Sample,
+            Runtime,
+            Degrees,
+        } kind;
+        const std::string *seriesKey;
+        double value;
+        double interval;
+        Epoch time;
+    };
+
+    Transport mTransport{};
+    AsyncWriter *mWriter{nullptr};
+    Limits mLimits;
+    Epoch mMeasurementEpoch{0};         ///< The time stamp of the current measurement set.
+    std::string mMeasurements{};        ///< The current measurement set.
+    std::size_t mMeasurementCount{0};   ///< The number of points in the current measurement set.
+    std::string mBatch{};               ///< Points waiting to be written.
+    std::size_t mBatchCount{0};         ///< The number of points waiting to be written.
+    std::chrono::steady_clock::time_point mBatchStart{};    ///< When the first waiting point was added.
+    std::size_t mQueuedCount{0};        ///< The number of batches handed to the transport or writer.
+    std::size_t mRequestCount{0};       ///< The number of batches written.
+    std::deque<std::uint64_t> mTickets{};   ///< The writer tickets of batches queued but not seen written.
+    States mStates{};                   ///< The state points in pushed measurement sets.
+    std::vector<std::pair<State *, State>> mPendingStates{};    ///< The state points in the measurement set.
+    Rollup *mRollup{nullptr};
+    std::vector<RollupValue> mPendingRollup{};  ///< The rollup values of the measurement set.
+    bool mRollupOpen{false};            ///< The open periods have changed since they were last written.
+
+    /**
+     * @brief Hand the batch to the transport, or queue it with the writer.
+     */
+    void write();
+
+    /**
+     * @brief Count the queued batches the writer has written.
+     */
+    void collect();
+
+    void appendPoint(const std::string &seriesKey, std::string_view value, Epoch timestamp);
+
+    /**
+     * @brief Format a number with the precision of the limits.
+     * @return The text in the buffer, empty if the value is not finite.
+     */
+    template<typename Number>
+    std::string_view formatNumber(Number value, std::array<char, 64> &buffer) const;
+
+public:
+    InfluxBatch() = delete;
+    InfluxBatch(const InfluxBatch &) = delete;
+    InfluxBatch &operator=(const InfluxBatch &) = delete;
+
+    /**
+     * @brief Write batches to the InfluxDB HTTP API.
+     * @param host The database server host name.
+     * @param tls True to use https.
+     * @param port The database connection port.
+     * @param db The database name.
+     * @param limits The batch limits.
+     */
+    InfluxBatch(const std::string &host, bool tls, long port, const std::string &db, Limits limits);
+
+    /**
+     * @brief Write batches with a caller supplied transport.
+     */
+    InfluxBatch(Transport transport, Limits limits);
+
+    /**
+     * @brief Queue batches with a writer, it must outlive the batch.
+     */
+    InfluxBatch(AsyncWriter &writer, Limits limits);
+
+    /**
+     * @brief A transport writing to the InfluxDB HTTP API.
+     * @param host The database server host name.
+     * @param tls True to use https.
+     * @param port The database connection port.
+     * @param db The database name.
+     * @param gzipLevel If 1 to 9 request bodies are gzip compressed at this level, if 0 they are not.
+     * @details A 4xx response other than 429 (too many requests) throws InfluxRejected.
+     */
+    static Transport httpTransport(const std::string &host, bool tls, long port, const std::string &db,
+                                   int gzipLevel = 0);
+
+    /**
+     * @brief Write any waiting points. Errors are reported but not thrown, call flush() to catch them.
+     */
+    ~InfluxBatch();
+
+    /**
+     * @brief Start a new measurement set, discarding any measurements not pushed.
+     */
+    void newMeasurements();
+
+    /**
+     * @brief Set the time stamp of the current measurement set.
+     * @param date The local date as YYYY-MM-DD.
+     * @param time The local time as HH:MM:SS.
+     */
+    void setMeasurementEpoch(std::string_view date, std::string_view time);
+
+    void setMeasurementEpoch(Epoch epoch) {
+        mMeasurementEpoch = epoch;
+    }
+
+    /**
+     * @brief Convert a local date and time to an epoch.
+     * @param date The local date as YYYY-MM-DD.
+     * @param time The local time as HH:MM:SS.
+     * @return Nanoseconds since the Unix epoch.
+     */
+    static Epoch localEpoch(std::string_view date, std::string_view time);
+
+    [[nodiscard]] Epoch getMeasurementEpoch() const {
+        return mMeasurementEpoch;
+    }
+
+    /**
+     * @brief Add a point to the current measurement set.
+     * @details With a rollup a value that is a number is also sampled, the series key must outlive the set.
+     * @param seriesKey The escaped series key.
+     * @param value The field value.
+     * @param timestamp The point time stamp, if 0 the measurement set time stamp is used.
+     * @return True if a point was added, false if the value is missing or empty.
+     */
+    bool addPoint(const std::string &seriesKey, std::optional<std::string_view> value, Epoch timestamp = 0);
+
+    /**
+     * @brief Add a numeric point to the current measurement set.
+     * @param seriesKey The escaped series key.
+     * @param value The field value, written with the precision of the limits.
+     * @param timestamp The point time stamp, if 0 the measurement set time stamp is used.
+     * @return True if a point was added, false if the value is not finite.
+     */
+    bool addPoint(const std::string &seriesKey, float value, Epoch timestamp = 0);
+
+    bool addPoint(const std::string &seriesKey, double value, Epoch timestamp = 0);
+
+    /**
+     * @brief Add a state point to the current measurement set if the state has changed or a keyframe is due.
+     * @details Without a state keyframe interval the point is always added. A point earlier than the last
+     * one written for the series is always added. The state is recorded when the measurement set is pushed.
+     * @param seriesKey The escaped series key.
+     * @param value The field value.
+     * @param timestamp The point time stamp, if 0 the measurement set time stamp is used.
+     * @return True if the value is present, whether or not a point was added.
+     */
+    bool addState(const std::string &seriesKey, std::string_view value, Epoch timestamp = 0);
+
+    /**
+     * @brief Add a numeric state point, compared as written with the precision of the limits.
+     * @return True if the value is finite, whether or not a point was added.
+     */
+    bool addState(const std::string &seriesKey, double value, Epoch timestamp = 0);
+
+    [[nodiscard]] const States &states() const {
+        return mStates;
+    }
+
+    /**
+     * @brief Continue from the states written by an earlier batch.
+     */
+    void setStates(States states) {
+        mStates = std::move(states);
+    }
+
+    /**
+     * @brief Forget the states written, the next point of every state series is written.
+     */
+    void clearStates() {
+        mStates.clear();
+    }
+
+    /**
+     * @brief Accumulate hourly and daily aggregates in a rollup, nullptr for none.
+     * @details The rollup must outlive the batch. Its open periods are written by flush().
+     */
+    void setRollup(Rollup *rollup);
+
+    /**
+     * @brief Add the seconds a state series was on during an interval to the rollup.
+     * @details Nothing is written to the series, the series key must outlive the measurement set.
+     * @param seriesKey The escaped series key.
+     * @param seconds The seconds on.
+     * @param interval The seconds of the interval.
+     * @param timestamp The start of the interval, if 0 the measurement set time stamp is used.
+     */
+    void addRuntime(const std::string &seriesKey, double seconds, double interval = DefaultInterval,
+                    Epoch timestamp = 0);
+
+    /**
+     * @brief Add an outdoor temperature in Celsius held for an interval to the degree hours of a series in the
+     * rollup.
+     * @details Nothing is written to the series, the series key must outlive the measurement set.
+     */
+    void addDegrees(const std::string &seriesKey, double temperature, double interval = DefaultInterval,
+                    Epoch timestamp = 0);
+
+    /**
+     * @brief Move the current measurement set into the batch, writing the batch if a limit is reached.
+     */
+    void pushData();
+
+    /**
+     * @brief Discard the points of a measurement set written by an earlier run, keeping its rollup values.
+     */
+    void discardData();
+
+    /**
+     * @brief Write the batch if the oldest point in it has reached the age limit.
+     * @details pushData() calls this, call it between measurement sets to write points that would otherwise wait.
+     */
+    void flushIfDue();
+
+    /**
+     * @brief Write all waiting points, waiting for batches queued with a writer to be written.
+     * @throws InfluxError or the transport's exception if the batch was not written. With a transport the
+     * points are kept, with a writer they are discarded and the writer fails every later call.
+     */
+    void flush();
+
+    /**
+     * @brief The number of batches handed to the transport or queued with the writer.
+     */
+    [[nodiscard]] std::size_t batchCount() const {
+        return mQueuedCount;
+    }
+
+    /**
+     * @brief The number of batches known to be written, it is brought up to date by pushData() and flush().
+     */
+    [[nodiscard]] std::size_t requestCount() const {
+        return mRequestCount;
+    }
+};
+
+#endif //ECOBEEDATA_INFLUXBATCH_H
@@ -0,0 +1,232 @@
+/**
+ * @file Rollup.cpp
+ */
+
+#include <algorithm>
+#include <charconv>
+#include "Rollup.h"
+
+namespace {
+    constexpr Rollup::Epoch NanoSeconds = 1000000000ULL;
+    constexpr double SecondsPerHour = 3600.;
+
+    constexpr std::array<std::string_view, 2> PeriodSuffix{"\\ hourly ", "\\ daily "};
+
+    template<typename Number>
+    void appendNumber(std::string &text, Number value, int precision = -1) {
+        std::array<char, 64> buffer{};
+        std::to_chars_result result{};
+        if constexpr (std::is_floating_point_v<Number>) {
+            result = precision < 0
+                     ? std::to_chars(buffer.data(), buffer.data() + buffer.size(), value)
+                     : std::to_chars(buffer.data(), buffer.data() + buffer.size(), value, std::chars_format::fixed,
+                                     precision);
+        } else {
+            result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+        }
+        text.append(buffer.data(), result.ptr);
+    }
+
+    /**
+     * @brief Read a number from the front of text, removing it and the space after it.
+     */
+    template<typename Number>
+    bool readNumber(std::string_view &text, Number &value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc{} || result.ptr == text.data() + text.size() || *result.ptr != ' ')
+            return false;
+        text.remove_prefix(static_cast<std::size_t>(result.ptr - text.data()) + 1);
+        return true;
+    }
+}
+
+void Rollup::Accumulator::reset(Epoch periodStart) {
+    start = periodStart;
+    count = 0;
+    min = max = sum = 0.;
+    runtime = observed = 0.;
+    heating = cooling = degreeObserved = 0.;
+}
+
+const std::array<Rollup::Epoch, Rollup::PeriodCount> &Rollup::periodStarts(Epoch epoch) {
+    if (epoch != mPeriodEpoch) {
+        auto time = static_cast<std::time_t>(epoch / NanoSeconds);
+        std::tm local{};
+        localtime_r(&time, &local);
+        auto hour = time - (local.tm_min * 60 + local.tm_sec);
+        local.tm_hour = local.tm_min = local.tm_sec = 0;
+        local.tm_isdst = -1;    // Let mktime work out if DST was in effect at midnight.
+        auto day = std::mktime(&local);
+        mPeriodStarts = {static_cast<Epoch>(hour) * NanoSeconds, static_cast<Epoch>(day) * NanoSeconds};
+        mPeriodEpoch = epoch;
+    }
+    return mPeriodStarts;
+}
+
+template<class Update>
+void Rollup::accumulate(const std::string &seriesKey, Epoch epoch, Update &&update) {
+    auto series = mSeries.find(seriesKey);
+    if (series == mSeries.end())
+        series = mSeries.emplace(seriesKey, Series{}).first;
+
+    const auto &starts = periodStarts(epoch);
+    for (std::size_t period = 0; period < PeriodCount; ++period) {
+        auto &accumulator = series->second[period];
+        if (starts[period] != accumulator.start) {
+            // A value before the open period belongs to a period already written.
+            if (starts[period] < accumulator.start)
+                continue;
+            if (!accumulator.empty()) {
+                appendLine(mCompleted, series->first, static_cast<Period>(period), accumulator);
+                ++mCompletedCount;
+            }
+            accumulator.reset(starts[period]);
+        }
+        update(accumulator);
+    }
+}
+
+void Rollup::sample(const std::string &seriesKey, double value, Epoch epoch) {
+    accumulate(seriesKey, epoch, [value, epoch](Accumulator &accumulator) {
+        if (epoch <= accumulator.lastSample)
+            return;
+        accumulator.lastSample = epoch;
+        accumulator.min = accumulator.count ? std::min(accumulator.min, value) : value;
+        accumulator.max = accumulator.count ? std::max(accumulator.max, value) : value;
+        accumulator.sum += value;
+        ++accumulator.count;
+    });
+}
+
+void Rollup::runtime(const std::string &seriesKey, double seconds, double interval, Epoch epoch) {
+    accumulate(seriesKey, epoch, [seconds, interval, epoch](Accumulator &accumulator) {
+        if (epoch <= accumulator.lastRuntime)
+            return;
+        accumulator.lastRuntime = epoch;
+        accumulator.runtime += seconds;
+        accumulator.observed += interval;
+    });
+}
+
+void Rollup::degrees(const std::string &seriesKey, double temperature, double interval, Epoch epoch) {
+    accumulate(seriesKey, epoch, [this, temperature, interval, epoch](Accumulator &accumulator) {
+        if (epoch <= accumulator.lastDegrees)
+            return;
+        accumulator.lastDegrees = epoch;
+        accumulator.heating += std::max(0., mBaseTemperature - temperature) * interval;
+        accumulator.cooling += std::max(0., temperature - mBaseTemperature) * interval;
+        accumulator.degreeObserved += interval;
+    });
+}
+
+void Rollup::appendLine(std::string &lines, std::string_view seriesKey, Period period,
+                        const Accumulator &accumulator) const {
+    lines.append(seriesKey).append(PeriodSuffix[static_cast<std::size_t>(period)]);
+    bool first = true;
+    auto field = [&](std::string_view name, double value) {
+        if (!first)
+            lines.push_back(',');
+        first = false;
+        lines.append(name).push_back('=');
+        appendNumber(lines, value, mPrecision);
+    };
+
+    if (accumulator.count) {
+        field("min", accumulator.min);
+        field("max", accumulator.max);
+        field("mean", accumulator.sum / static_cast<double>(accumulator.count));
+        lines.append(",count=");
+        appendNumber(lines, accumulator.count);
+        lines.push_back('i');
+    }
+    if (accumulator.observed > 0.) {
+        field("runtime", accumulator.runtime);
+        field("duty", 100. * accumulator.runtime / accumulator.observed);
+    }
+    if (accumulator.degreeObserved > 0.) {
+        field("heatingDegreeHours", accumulator.heating / SecondsPerHour);
+        field("coolingDegreeHours", accumulator.cooling / SecondsPerHour);
+    }
+    lines.push_back(' ');
+    appendNumber(lines, accumulator.start);
+    lines.push_back('\n');
+}
+
+std::size_t Rollup::takeCompleted(std::string &lines) {
+    auto count = mCompletedCount;
+    lines.append(mCompleted);
+    mCompleted.clear();
+    mCompletedCount = 0;
+    return count;
+}
+
+std::size_t Rollup::appendOpen(std::string &lines) const {
+    std::size_t count{0};
+    for (const auto &[seriesKey, series] : mSeries) {
+        for (std::size_t period = 0; period < PeriodCount; ++period) {
+            if (!series[period].empty()) {
+                appendLine(lines, seriesKey, static_cast<Period>(period), series[period]);
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+void Rollup::clear() {
+    mSeries.clear();
+    mCompleted.clear();
+    mCompletedCount = 0;
+}
+
+std::string Rollup::state() const {
+    std::string text{};
+    for (const auto &[seriesKey, series] : mSeries) {
+        for (std::size_t period = 0; period < PeriodCount; ++period) {
+            const auto &accumulator = series[period];
+            if (accumulator.start == 0)
+                continue;
+            appendNumber(text, period);
+            for (auto epoch : {accumulator.start, accumulator.lastSample, accumulator.lastRuntime,
+                               accumulator.lastDegrees}) {
+                text.push_back(' ');
+                appendNumber(text, epoch);
+            }
+            text.push_back(' ');
+            appendNumber(text, accumulator.count);
+            for (auto value : {accumulator.min, accumulator.max, accumulator.sum, accumulator.runtime,
+                               accumulator.observed, accumulator.heating, accumulator.cooling,
+                               accumulator.degreeObserved}) {
+                text.push_back(' ');
+                appendNumber(text, value);
+            }
+            text.push_back(' ');
+            text.append(seriesKey).push_back('\n');
+        }
+    }
+    return text;
+}
+
+void Rollup::restore(std::string_view state) {
+    while (!state.empty()) {
+        auto end = state.find('\n');
+        auto line = state.substr(0, end);
+        state.remove_prefix(end == std::string_view::npos ? state.size() : end + 1);
+
+        std::size_t period{};
+        Accumulator accumulator{};
+        if (readNumber(line, period) && period < PeriodCount &&
+            readNumber(line, accumulator.start) && readNumber(line, accumulator.lastSample) &&
+            readNumber(line, accumulator.lastRuntime) && readNumber(line, accumulator.lastDegrees) &&
+            readNumber(line, accumulator.count) && readNumber(line, accumulator.min) &&
+            readNumber(line, accumulator.max) && readNumber(line, accumulator.sum) &&
+            readNumber(line, accumulator.runtime) && readNumber(line, accumulator.observed) &&
+            readNumber(line, accumulator.heating) && readNumber(line, accumulator.cooling) &&
+            readNumber(line, accumulator.degreeObserved) && !line.empty()) {
+            auto series = mSeries.find(line);
+            if (series == mSeries.end())
+                series = mSeries.emplace(std::string{line}, Series{}).first;
+            series->second[period] = accumulator;
+        }
+    }
+}
@@ -0,0 +1,151 @@
+/**
+ * @file Rollup.h
+ * @brief Hourly and daily aggregates of the series written, so long range queries do not scan every point.
+ * @details Values are accumulated by series and by local hour and day as they are written. When a value falls
+ * in a later period the earlier period is complete and its aggregate is written. Open periods are written as
+ * they stand when the batch is flushed, and again with the same time stamp once they gain more values, so the
+ * last write of a period holds the whole period. The open periods can be saved and restored, a period split
+ * across runs combines into one aggregate. Aggregates are written to the series key followed by " hourly" or
+ * " daily":
+ *  - Samples: min, max, mean and count.
+ *  - Runtime: runtime seconds and duty, runtime as a percentage of the time observed.
+ *  - Degrees: heatingDegreeHours and coolingDegreeHours below and above the base temperature.
+ * A value at or before the last one accumulated for a series is ignored, so rows written again are not
+ * counted twice.
+ */
+
+#ifndef ECOBEEDATA_ROLLUP_H
+#define ECOBEEDATA_ROLLUP_H
+
+#include <array>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @class Rollup
+ */
+class Rollup {
+public:
+    using Epoch = unsigned long long;   ///< Nanoseconds since the Unix epoch.
+
+    static constexpr double DefaultBaseTemperature = 18.;
+
+    enum class Period {
+        Hourly,
+        Daily,
+    };
+
+private:
+    static constexpr std::size_t PeriodCount = 2;
+
+    /**
+     * The values of one series in one period. The last epochs are kept from one period to the next.
+     */
+    struct Accumulator {
+        Epoch start{0};             ///< The start of the period.
+        Epoch lastSample{0}, lastRuntime{0}, lastDegrees{0};
+        std::size_t count{0};
+        double min{0.}, max{0.}, sum{0.};
+        double runtime{0.}, observed{0.};           ///< Runtime seconds and seconds observed.
+        double heating{0.}, cooling{0.}, degreeObserved{0.};  ///< Degree seconds and seconds observed.
+
+        [[nodiscard]] bool empty() const {
+            return count == 0 && observed == 0. && degreeObserved == 0.;
+        }
+
+        void reset(Epoch periodStart);
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const noexcept {
+            return std::hash<std::string_view>{}(key);
+        }
+    };
+
+    using Series = std::array<Accumulator, PeriodCount>;
+
+    double mBaseTemperature;
+    std::unordered_map<std::string, Series, KeyHash, std::equal_to<>> mSeries{};
+    std::string mCompleted{};           ///< The line protocol of completed periods not yet taken.
+    std::size_t mCompletedCount{0};
+    int mPrecision{2};
+
+    Epoch mPeriodEpoch{~0ULL};          ///< The epoch mPeriodStarts was found for.
+    std::array<Epoch, PeriodCount> mPeriodStarts{};
+
+    /**
+     * @brief The accumulators of each period for a value at an epoch, completing the periods it follows.
+     */
+    template<class Update>
+    void accumulate(const std::string &seriesKey, Epoch epoch, Update &&update);
+
+    /**
+     * @brief The local start of the hour and day of an epoch.
+     */
+    const std::array<Epoch, PeriodCount> &periodStarts(Epoch epoch);
+
+    void appendLine(std::string &lines, std::string_view seriesKey, Period period,
+                    const Accumulator &accumulator) const;
+
+public:
+    /**
+     * @param baseTemperature The temperature in Celsius degree hours are counted from.
+     */
+    explicit Rollup(double baseTemperature = DefaultBaseTemperature) : mBaseTemperature(baseTemperature) {}
+
+    /**
+     * @brief Set the digits after the decimal point aggregates are written with, -1 for the shortest form.
+     */
+    void setPrecision(int precision) {
+        mPrecision = precision;
+    }
+
+    /**
+     * @brief Add a sample of a temperature, humidity or other measured series.
+     */
+    void sample(const std::string &seriesKey, double value, Epoch epoch);
+
+    /**
+     * @brief Add the seconds a state series was on during an interval.
+     */
+    void runtime(const std::string &seriesKey, double seconds, double interval, Epoch epoch);
+
+    /**
+     * @brief Add an outdoor temperature in Celsius held for an interval to the degree hours of a series.
+     */
+    void degrees(const std::string &seriesKey, double temperature, double interval, Epoch epoch);
+
+    /**
+     * @brief Move the line protocol of the periods completed since the last call to the end of lines.
+     * @return The number of points appended.
+     */
+    std::size_t takeCompleted(std::string &lines);
+
+    /**
+     * @brief Append the line protocol of the open periods as they stand.
+     * @return The number of points appended.
+     */
+    std::size_t appendOpen(std::string &lines) const;
+
+    /**
+     * @brief Forget every series and period.
+     */
+    void clear();
+
+    /**
+     * @brief The open periods as text, one accumulator per line.
+     */
+    [[nodiscard]] std::string state() const;
+
+    /**
+     * @brief Restore open periods saved by state(), lines that can not be read are ignored.
+     */
+    void restore(std::string_view state);
+};
+
+#endif //ECOBEEDATA_ROLLUP_H
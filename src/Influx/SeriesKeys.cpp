@@ -0,0 +1,29 @@
+/**
+ * @file SeriesKeys.cpp
+ */
+
+#include "SeriesKeys.h"
+
+const std::string &SeriesKeys::key(std::string_view name) {
+    if (auto found = mKeys.find(name); found != mKeys.end())
+        return found->second;
+
+    auto measurement = name;
+    if (auto pos = measurement.rfind(" ("); pos != std::string_view::npos)
+        measurement = measurement.substr(0, pos);
+
+    std::string series{mPrefix};
+    series.append(measurement);
+    return mKeys.emplace(std::string{name}, escape(series)).first->second;
+}
+
+std::string SeriesKeys::escape(std::string_view name) {
+    std::string escaped{};
+    escaped.reserve(name.size() + 8);
+    for (auto c : name) {
+        if (c == ' ' || c == ',')
+            escaped.push_back('\\');
+        escaped.push_back(c);
+    }
+    return escaped;
+}
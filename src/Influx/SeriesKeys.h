@@ -0,0 +1,53 @@
+/**
+ * @file SeriesKeys.h
+ * @brief Intern the line protocol series keys of measurements.
+ * @details A series key is built the first time a raw column or sensor name is seen and looked up after that,
+ * so encoding a point copies the key rather than escaping the name again.
+ */
+
+#ifndef ECOBEEDATA_SERIESKEYS_H
+#define ECOBEEDATA_SERIESKEYS_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @class SeriesKeys
+ */
+class SeriesKeys {
+    struct NameHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const noexcept {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    std::string mPrefix;
+    std::unordered_map<std::string, std::string, NameHash, std::equal_to<>> mKeys{};
+
+public:
+    /**
+     * @param prefix The measurement name prefix, for example "Home ".
+     */
+    explicit SeriesKeys(std::string prefix) : mPrefix(std::move(prefix)) {}
+
+    /**
+     * @brief The series key of a raw name.
+     * @param name A raw column or sensor name, a unit suffix such as " (F)" is removed.
+     * @return The escaped prefix and name, valid for the lifetime of this object.
+     */
+    const std::string &key(std::string_view name);
+
+    [[nodiscard]] const std::string &prefix() const {
+        return mPrefix;
+    }
+
+    /**
+     * @brief Escape spaces and commas, the only characters escaped in a line protocol measurement.
+     */
+    static std::string escape(std::string_view name);
+};
+
+#endif //ECOBEEDATA_SERIESKEYS_H
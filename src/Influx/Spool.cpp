@@ -0,0 +1,299 @@
+/**
+ * @file Spool.cpp
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <optional>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "Spool.h"
+
+namespace {
+    constexpr std::string_view SegmentExtension = ".lp";
+    constexpr std::string_view RejectedFile = "rejected.lp";     ///< Not a segment, its stem is not a number.
+
+    /**
+     * @brief The sequence number of a segment file name, std::nullopt if it is not a segment.
+     */
+    std::optional<std::uint64_t> segmentSequence(const std::filesystem::path &file) {
+        if (file.extension() != SegmentExtension)
+            return std::nullopt;
+        auto stem = file.stem().string();
+        std::uint64_t sequence{};
+        if (auto result = std::from_chars(stem.data(), stem.data() + stem.size(), sequence);
+                result.ec != std::errc{} || result.ptr != stem.data() + stem.size())
+            return std::nullopt;
+        return sequence;
+    }
+
+    void syncDirectory(const std::filesystem::path &path) {
+        if (auto dir = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir >= 0) {
+            ::fsync(dir);
+            ::close(dir);
+        }
+    }
+}
+
+Spool::Spool(std::filesystem::path path, std::size_t segmentBytes)
+        : mPath(std::move(path)), mSegmentBytes(segmentBytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(mPath, ec);
+    if (ec)
+        throw SpoolError("Spool " + mPath.string() + ": " + ec.message());
+
+    // New batches never go into a segment left by an earlier run, it may end part way through a batch. This is
+    // where the search for a free sequence number starts.
+    for (const auto &entry : std::filesystem::directory_iterator{mPath}) {
+        if (auto sequence = segmentSequence(entry.path()); sequence)
+            mSequence = std::max(mSequence, sequence.value() + 1);
+    }
+}
+
+Spool::~Spool() {
+    std::lock_guard<std::mutex> lock{mMutex};
+    closeLocked();
+}
+
+std::filesystem::path Spool::segmentPath(std::uint64_t sequence) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu", static_cast<unsigned long long>(sequence));
+    return mPath / (std::string{name} + std::string{SegmentExtension});
+}
+
+void Spool::openLocked() {
+    for (;;) {
+        auto path = segmentPath(mSequence++);
+        auto segment = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+        if (segment < 0) {
+            if (errno == EEXIST)
+                continue;       // Created by another process using the spool.
+            throw SpoolError("Spool " + path.string() + ": " + strerror(errno));
+        }
+
+        // A replay in another process may have locked the new segment, found it empty and removed it before it
+        // was locked here. It is then abandoned for the next sequence number.
+        struct stat status{};
+        if (::flock(segment, LOCK_EX) < 0 || ::fstat(segment, &status) < 0) {
+            std::string error{strerror(errno)};
+            ::close(segment);
+            throw SpoolError("Spool " + path.string() + ": " + error);
+        }
+        if (status.st_nlink == 0) {
+            ::close(segment);
+            continue;
+        }
+
+        mSegment = segment;
+        syncDirectory(mPath);
+        return;
+    }
+}
+
+void Spool::closeLocked() {
+    if (mSegment >= 0) {
+        ::close(mSegment);
+        mSegment = -1;
+        mSegmentSize = 0;
+    }
+}
+
+void Spool::append(std::string_view lines) {
+    if (lines.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (mSegment < 0)
+        openLocked();
+
+    // Part of a failed batch is cut off so the next batch is not appended to a partial line. If it can not be
+    // cut the segment is closed, a replay drops a partial last line.
+    auto failed = [this](const char *action) {
+        SpoolError error{std::string{"Spool "} + action + ": " + strerror(errno)};
+        if (::ftruncate(mSegment, static_cast<off_t>(mSegmentSize)) < 0)
+            closeLocked();
+        return error;
+    };
+
+    for (auto data = lines; !data.empty();) {
+        auto count = ::write(mSegment, data.data(), data.size());
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            throw failed("write");
+        }
+        data.remove_prefix(static_cast<std::size_t>(count));
+    }
+    if (::fdatasync(mSegment) < 0)
+        throw failed("sync");
+
+    mSegmentSize += lines.size();
+    mLastAppend = std::chrono::steady_clock::now();
+    if (mSegmentSize >= mSegmentBytes)
+        closeLocked();
+}
+
+void Spool::reject(std::string_view batch) const {
+    auto path = mPath / RejectedFile;
+    auto file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (file < 0)
+        throw SpoolError("Spool " + path.string() + ": " + strerror(errno));
+
+    for (auto data = batch; !data.empty();) {
+        auto count = ::write(file, data.data(), data.size());
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0) {
+            std::string error{strerror(errno)};
+            ::close(file);
+            throw SpoolError("Spool " + path.string() + ": " + error);
+        }
+        data.remove_prefix(static_cast<std::size_t>(count));
+    }
+    if (::fdatasync(file) < 0) {
+        std::string error{strerror(errno)};
+        ::close(file);
+        throw SpoolError("Spool " + path.string() + ": " + error);
+    }
+    ::close(file);
+}
+
+InfluxBatch::Transport Spool::transport() {
+    return [this](const std::string &body) { append(body); };
+}
+
+std::size_t Spool::replay(const InfluxBatch::Transport &influx, std::size_t batchBytes,
+                          std::chrono::steady_clock::duration idle) {
+    std::lock_guard<std::mutex> replayLock{mReplayMutex};
+
+    // A segment still being appended to is left open, the lock below skips it.
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (mSegment >= 0 && std::chrono::steady_clock::now() - mLastAppend >= idle)
+            closeLocked();
+    }
+
+    std::vector<std::pair<std::uint64_t, std::filesystem::path>> segments{};
+    for (const auto &entry : std::filesystem::directory_iterator{mPath}) {
+        if (auto sequence = segmentSequence(entry.path()); sequence)
+            segments.emplace_back(sequence.value(), entry.path());
+    }
+    std::sort(segments.begin(), segments.end());
+
+    std::size_t points{0};
+    bool removed{false};
+    for (const auto &[sequence, file] : segments) {
+        // Segments open for appending, here or in another process, or being replayed by another process are
+        // locked. One removed by another replay since the directory was read is gone or has no links.
+        auto segment = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (segment < 0) {
+            if (errno == ENOENT)
+                continue;
+            throw SpoolError("Spool " + file.string() + ": " + strerror(errno));
+        }
+        struct stat status{};
+        if (::flock(segment, LOCK_EX | LOCK_NB) < 0 || ::fstat(segment, &status) < 0 || status.st_nlink == 0) {
+            ::close(segment);
+            continue;
+        }
+
+        std::string content{};
+        std::array<char, 64 * 1024> buffer{};
+        for (;;) {
+            auto count = ::read(segment, buffer.data(), buffer.size());
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count < 0) {
+                std::string error{strerror(errno)};
+                ::close(segment);
+                throw SpoolError("Spool " + file.string() + ": " + error);
+            }
+            if (count == 0)
+                break;
+            content.append(buffer.data(), static_cast<std::size_t>(count));
+        }
+
+        // A batch cut short by a crash leaves a partial last line, it was never reported as written.
+        std::string_view text{content};
+        text = text.substr(0, text.rfind('\n') + 1);
+
+        while (!text.empty()) {
+            auto size = text.size();
+            if (size > batchBytes) {
+                size = text.rfind('\n', batchBytes - 1) + 1;
+                if (size == 0)
+                    size = text.find('\n') + 1;
+            }
+            auto batch = text.substr(0, size);
+            auto lines = static_cast<std::size_t>(std::count(batch.begin(), batch.end(), '\n'));
+            try {
+                try {
+                    influx(std::string{batch});
+                    points += lines;
+                } catch (const InfluxRejected &e) {
+                    // Writing it again would fail again and hold up every later segment.
+                    reject(batch);
+                    std::cerr << "Spool: " << lines << " points moved to " << (mPath / RejectedFile).string()
+                              << ", " << e.what() << '\n';
+                }
+            } catch (...) {
+                ::close(segment);
+                throw;
+            }
+            text.remove_prefix(size);
+        }
+
+        // Removed while it is locked so a process that has just created it sees it is gone.
+        std::filesystem::remove(file);
+        ::close(segment);
+        removed = true;
+    }
+    if (removed)
+        syncDirectory(mPath);
+    return points;
+}
+
+SpoolReplayer::SpoolReplayer(Spool &spool, InfluxBatch::Transport influx, std::chrono::seconds interval,
+                             std::size_t batchBytes)
+        : mSpool(spool), mInflux(std::move(influx)), mBatchBytes(batchBytes), mInterval(interval),
+          mWorker([this](const std::stop_token &stop) { replay(stop); }) {}
+
+SpoolReplayer::~SpoolReplayer() {
+    mWorker.request_stop();
+    if (mWorker.joinable())
+        mWorker.join();
+    replayOnce(std::chrono::steady_clock::duration::zero());
+}
+
+void SpoolReplayer::notify() {
+    std::lock_guard lock{mMutex};
+    mNotified = true;
+    mChanged.notify_all();
+}
+
+void SpoolReplayer::replayOnce(std::chrono::steady_clock::duration idle) noexcept {
+    try {
+        mSpool.replay(mInflux, mBatchBytes, idle);
+    } catch (const std::exception &e) {
+        std::cerr << "Spool replay: " << e.what() << '\n';
+    }
+}
+
+void SpoolReplayer::replay(const std::stop_token &stop) {
+    for (bool notified = false; !stop.stop_requested();) {
+        replayOnce(notified ? std::chrono::steady_clock::duration::zero()
+                            : std::chrono::steady_clock::duration{mInterval});
+
+        std::unique_lock lock{mMutex};
+        notified = mChanged.wait_for(lock, stop, mInterval, [this]() { return mNotified; });
+        mNotified = false;
+    }
+}
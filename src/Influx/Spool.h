@@ -0,0 +1,163 @@
+/**
+ * @file Spool.h
+ * @brief A durable on disk spool of line protocol points waiting to be written to the database.
+ * @details Batches are appended to segment files and synced to disk before append() returns, so a batch
+ * flushed through the spool survives the database being down and the process being stopped. A replayer
+ * drains whole segments to the database in large requests and removes each one once it has been written.
+ * A segment interrupted part way through is written again from its start; InfluxDB keeps one value per
+ * series and time stamp, so points written twice are not duplicated. More than one process may share a spool,
+ * a segment is locked while it is open for appending and while it is replayed. A batch the database rejects
+ * outright is moved to a rejected file in the spool directory rather than blocking the segments after it.
+ */
+
+#ifndef ECOBEEDATA_SPOOL_H
+#define ECOBEEDATA_SPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "InfluxBatch.h"
+
+class SpoolError : public std::runtime_error {
+public:
+    explicit SpoolError(const std::string& what_arg) : std::runtime_error(what_arg) {}
+};
+
+/**
+ * @class Spool
+ * @details Segments are named by a sequence number so they replay in the order they were written. A segment
+ * is closed when it reaches the segment size or when a replay finds it idle, later batches start a new segment.
+ * A process takes the next sequence number no other process has created. All members may be called from more
+ * than one thread.
+ */
+class Spool {
+public:
+    static constexpr std::size_t DefaultSegmentBytes = 8 * 1024 * 1024;
+
+private:
+    std::filesystem::path mPath;
+    std::size_t mSegmentBytes;
+
+    std::mutex mMutex{};
+    int mSegment{-1};                   ///< The open segment, -1 if none is open.
+    std::size_t mSegmentSize{0};        ///< The bytes written to the open segment.
+    std::uint64_t mSequence{0};         ///< The sequence number of the next segment.
+    std::chrono::steady_clock::time_point mLastAppend{};
+
+    std::mutex mReplayMutex{};          ///< One replay at a time.
+
+    [[nodiscard]] std::filesystem::path segmentPath(std::uint64_t sequence) const;
+
+    /**
+     * @brief Create and lock the next segment.
+     */
+    void openLocked();
+
+    void closeLocked();
+
+    /**
+     * @brief Keep a batch the database rejected in the rejected file, synced to disk.
+     * @throws SpoolError if the batch can not be written or synced.
+     */
+    void reject(std::string_view batch) const;
+
+public:
+    Spool() = delete;
+    Spool(const Spool &) = delete;
+    Spool &operator=(const Spool &) = delete;
+
+    /**
+     * @param path The spool directory, it is created if it does not exist.
+     * @param segmentBytes The size at which a segment is closed.
+     * @throws SpoolError if the directory can not be created.
+     */
+    explicit Spool(std::filesystem::path path, std::size_t segmentBytes = DefaultSegmentBytes);
+
+    ~Spool();
+
+    /**
+     * @brief Append a batch of complete lines and sync it to disk.
+     * @details A batch that fails is cut off the segment again, or the segment is closed, so the next batch
+     * starts on a line of its own.
+     * @throws SpoolError if the batch can not be written or synced.
+     */
+    void append(std::string_view lines);
+
+    /**
+     * @brief A transport that appends each batch to the spool.
+     */
+    InfluxBatch::Transport transport();
+
+    /**
+     * @brief Write every spooled batch to the database, oldest first.
+     * @details The open segment is closed first if nothing has been appended to it for the idle time, otherwise
+     * it is left for a later replay. Segments open in other processes are skipped.
+     * @param influx The database transport.
+     * @param batchBytes The largest request, segments are split at line boundaries.
+     * @param idle The time without an append after which the open segment is closed and written, zero writes
+     * everything appended before the call.
+     * A batch the transport rejects with InfluxRejected is moved to the rejected file and the replay goes on.
+     * @throws The transport's exception, the segment it failed on and those after it are kept.
+     * @return The number of points written.
+     */
+    std::size_t replay(const InfluxBatch::Transport &influx, std::size_t batchBytes,
+                       std::chrono::steady_clock::duration idle = std::chrono::steady_clock::duration::zero());
+};
+
+/**
+ * @class SpoolReplayer
+ * @brief Drain a spool to the database on a thread of its own.
+ * @details The spool is replayed every interval and when notified. An interval replay leaves the open segment
+ * until it has been idle for an interval, a notified replay writes everything appended. A replay that fails is
+ * retried at the next interval. A final replay is attempted when the replayer is destroyed, what it can not write stays in the
+ * spool for the next run.
+ */
+class SpoolReplayer {
+    Spool &mSpool;
+    InfluxBatch::Transport mInflux;
+    std::size_t mBatchBytes;
+    std::chrono::seconds mInterval;
+
+    std::mutex mMutex{};
+    std::condition_variable_any mChanged{};
+    bool mNotified{false};
+    std::jthread mWorker;               ///< Started last, the members it uses are constructed before it.
+
+    void replay(const std::stop_token &stop);
+
+    /**
+     * @brief Replay once, reporting an error rather than throwing it.
+     */
+    void replayOnce(std::chrono::steady_clock::duration idle) noexcept;
+
+public:
+    static constexpr std::size_t DefaultBatchBytes = 4 * 1024 * 1024;
+
+    SpoolReplayer() = delete;
+    SpoolReplayer(const SpoolReplayer &) = delete;
+    SpoolReplayer &operator=(const SpoolReplayer &) = delete;
+
+    /**
+     * @param spool The spool, it must outlive the replayer.
+     * @param influx The database transport.
+     * @param interval The time between replays.
+     * @param batchBytes The largest request.
+     */
+    SpoolReplayer(Spool &spool, InfluxBatch::Transport influx, std::chrono::seconds interval,
+                  std::size_t batchBytes = DefaultBatchBytes);
+
+    ~SpoolReplayer();
+
+    /**
+     * @brief Replay now rather than at the next interval.
+     */
+    void notify();
+};
+
+#endif //ECOBEEDATA_SPOOL_H
@@ -0,0 +1,133 @@
+/**
+ * @file DelimiterScanner.h
+ * @brief Find every field delimiter and line end in a text in a single vectorized pass.
+ * @details The text is examined 64 bytes at a time. Each block is compared against both characters with
+ * AVX2, SSE2 or NEON, whichever the compiler targets, or a scalar loop otherwise, giving a 64 bit mask of
+ * matching positions. Positions are then taken from the mask one bit at a time.
+ */
+
+#ifndef ECOBEEDATA_DELIMITERSCANNER_H
+#define ECOBEEDATA_DELIMITERSCANNER_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace ecoBee {
+
+    /**
+     * @class DelimiterScanner
+     */
+    class DelimiterScanner {
+    public:
+        static constexpr std::size_t npos = std::string_view::npos;
+        static constexpr std::size_t BlockSize = 64;
+
+    private:
+        std::string_view mText;
+        char mFirst, mSecond;
+        std::size_t mBlock{0};      ///< Offset of the block mMask describes.
+        std::size_t mNext{0};       ///< Offset of the next block to examine.
+        uint64_t mMask{0};          ///< Matches in the current block not yet returned.
+
+        /**
+         * @brief Match both characters against a whole block.
+         * @param block Pointer to BlockSize readable bytes.
+         * @return Bit n is set if block[n] matches.
+         */
+        [[nodiscard]] uint64_t matchBlock(const char *block) const {
+#if defined(__AVX2__)
+            auto first = _mm256_set1_epi8(mFirst);
+            auto second = _mm256_set1_epi8(mSecond);
+            auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+            auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+            auto loMatch = _mm256_or_si256(_mm256_cmpeq_epi8(lo, first), _mm256_cmpeq_epi8(lo, second));
+            auto hiMatch = _mm256_or_si256(_mm256_cmpeq_epi8(hi, first), _mm256_cmpeq_epi8(hi, second));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(loMatch)) |
+                   static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hiMatch))) << 32;
+#elif defined(__SSE2__)
+            auto first = _mm_set1_epi8(mFirst);
+            auto second = _mm_set1_epi8(mSecond);
+            uint64_t mask{0};
+            for (unsigned int idx = 0; idx < 4; ++idx) {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + idx * 16));
+                auto match = _mm_or_si128(_mm_cmpeq_epi8(chunk, first), _mm_cmpeq_epi8(chunk, second));
+                mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(match))) << (idx * 16);
+            }
+            return mask;
+#elif defined(__ARM_NEON)
+            static constexpr uint8_t weightData[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+            auto weights = vld1q_u8(weightData);
+            auto first = vdupq_n_u8(static_cast<uint8_t>(mFirst));
+            auto second = vdupq_n_u8(static_cast<uint8_t>(mSecond));
+            uint64_t mask{0};
+            for (unsigned int idx = 0; idx < 4; ++idx) {
+                auto chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(block + idx * 16));
+                auto match = vandq_u8(vorrq_u8(vceqq_u8(chunk, first), vceqq_u8(chunk, second)), weights);
+                // Pairwise adds fold each half to one byte, vpadd_u8 is also available on 32 bit ARM.
+                auto sum = vpadd_u8(vget_low_u8(match), vget_high_u8(match));
+                sum = vpadd_u8(sum, sum);
+                sum = vpadd_u8(sum, sum);
+                mask |= static_cast<uint64_t>(vget_lane_u16(vreinterpret_u16_u8(sum), 0)) << (idx * 16);
+            }
+            return mask;
+#else
+            uint64_t mask{0};
+            for (std::size_t idx = 0; idx < BlockSize; ++idx) {
+                if (block[idx] == mFirst || block[idx] == mSecond)
+                    mask |= uint64_t{1} << idx;
+            }
+            return mask;
+#endif
+        }
+
+        [[nodiscard]] uint64_t blockMask(std::size_t offset) const {
+            if (offset + BlockSize <= mText.size())
+                return matchBlock(mText.data() + offset);
+
+            // The last partial block is copied so the vector loads stay inside the text.
+            char tail[BlockSize];
+            auto length = mText.size() - offset;
+            std::memcpy(tail, mText.data() + offset, length);
+            std::memset(tail + length, mFirst == '\0' || mSecond == '\0' ? 1 : 0, BlockSize - length);
+            return matchBlock(tail) & ((uint64_t{1} << length) - 1);
+        }
+
+    public:
+        /**
+         * @brief Scan a text for two characters.
+         * @param text The text, it must outlive the scanner.
+         * @param first A character to find, usually the field delimiter.
+         * @param second Another character to find, usually the line end. Pass first again to find only one.
+         */
+        DelimiterScanner(std::string_view text, char first, char second = '\n')
+                : mText(text), mFirst(first), mSecond(second) {}
+
+        /**
+         * @brief The next position of either character.
+         * @return The offset into the text, or npos when there are no more.
+         */
+        std::size_t next() {
+            while (mMask == 0) {
+                if (mNext >= mText.size())
+                    return npos;
+                mBlock = mNext;
+                mMask = blockMask(mBlock);
+                mNext += BlockSize;
+            }
+            auto bit = static_cast<std::size_t>(std::countr_zero(mMask));
+            mMask &= mMask - 1;
+            return mBlock + bit;
+        }
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_DELIMITERSCANNER_H
@@ -0,0 +1,146 @@
+/**
+ * @file Tokens.h
+ * @brief A lazy range of the tokens of a delimited string.
+ * @details Tokens are std::string_view into the source so none are copied and nothing is allocated. Single
+ * character delimiters are found with a DelimiterScanner.
+ */
+
+#ifndef ECOBEEDATA_TOKENS_H
+#define ECOBEEDATA_TOKENS_H
+
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+#include "DelimiterScanner.h"
+
+namespace ecoBee {
+
+    /**
+     * @class Tokens
+     * @details An empty source has no tokens and no token is produced before a leading delimiter. Otherwise
+     * every delimiter separates two tokens, either of which may be empty, so "a,,b," gives "a", "", "b" and "".
+     * These are the tokens the original tokenizeString() loop produced. The source must outlive the range
+     * and every token taken from it.
+     */
+    class Tokens : public std::ranges::view_interface<Tokens> {
+    public:
+        class Iterator {
+            static constexpr std::size_t npos = std::string_view::npos;
+
+            std::string_view mSource{};
+            std::string_view mDelim{};  ///< A string delimiter, empty for a character delimiter.
+            std::size_t mDelimSize{1};
+            DelimiterScanner mScanner{{}, '\0', '\0'};
+            std::size_t mStart{npos};   ///< The start of the current token, npos at the end.
+            std::size_t mEnd{0};        ///< The end of the current token.
+
+            /**
+             * @brief The position of the next delimiter at or after from, or the source size if there is none.
+             * @details Successive calls must be made with increasing from.
+             */
+            std::size_t findDelim(std::size_t from) {
+                std::size_t pos;
+                if (mDelim.empty()) {
+                    do {
+                        pos = mScanner.next();
+                    } while (pos != npos && pos < from);
+                } else {
+                    pos = mSource.find(mDelim, from);
+                }
+                return pos == npos ? mSource.size() : pos;
+            }
+
+            void first() {
+                if (mSource.empty())
+                    return;
+                mStart = 0;
+                mEnd = findDelim(0);
+                if (mEnd == 0) {
+                    mStart = mDelimSize;
+                    mEnd = findDelim(mStart);
+                }
+            }
+
+        public:
+            using iterator_concept = std::forward_iterator_tag;
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+
+            /**
+             * @param source The delimited string.
+             * @param delim The delimiter, it must not be empty.
+             */
+            Iterator(std::string_view source, std::string_view delim)
+                    : mSource(source), mDelim(delim), mDelimSize(delim.size()) {
+                first();
+            }
+
+            Iterator(std::string_view source, char delim) : mSource(source), mScanner(source, delim, delim) {
+                first();
+            }
+
+            std::string_view operator*() const {
+                return mSource.substr(mStart, mEnd - mStart);
+            }
+
+            Iterator &operator++() {
+                if (mEnd >= mSource.size()) {
+                    mStart = npos;
+                } else {
+                    mStart = mEnd + mDelimSize;
+                    mEnd = findDelim(mStart);
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator==(const Iterator &other) const {
+                return mStart == other.mStart && mSource.data() == other.mSource.data();
+            }
+
+            bool operator==(std::default_sentinel_t) const {
+                return mStart == npos;
+            }
+        };
+
+    private:
+        std::string_view mSource{};
+        std::string_view mDelim{};  ///< A string delimiter, empty for a character delimiter.
+        char mChar{','};
+
+    public:
+        Tokens() = default;
+
+        /**
+         * @param source The delimited string.
+         * @param delim The delimiter, a string of one or more characters which must outlive the range.
+         */
+        Tokens(std::string_view source, std::string_view delim) : mSource(source), mDelim(delim) {}
+
+        /**
+         * @param source The delimited string.
+         * @param delim The delimiter character.
+         */
+        Tokens(std::string_view source, char delim) : mSource(source), mChar(delim) {}
+
+        [[nodiscard]] Iterator begin() const {
+            return mDelim.empty() ? Iterator{mSource, mChar} : Iterator{mSource, mDelim};
+        }
+
+        [[nodiscard]] std::default_sentinel_t end() const {
+            return std::default_sentinel;
+        }
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_TOKENS_H
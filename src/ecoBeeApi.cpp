@@ -4,7 +4,23 @@
 // https://www.normalexception.net/Code-Development/ecobee3-api
 
 #include "Api.h"
+#include "RuntimeReportReader.h"
+#include "ReportArchive.h"
+#include "Coverage.h"
+#include "Spool.h"
+#include "GzipEncoder.h"
+#include "AsyncWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
 #include <sstream>
+#include <thread>
 #include "XDGFilePaths.h"
 #include "InputParser.h"
 #include "StringComposite.h"
@@ -42,6 +58,20 @@ enum class ConfigItem {
     InfluxPort,
     InfluxDb,
     DeleteProcessed,
+    InfluxBatchPoints,
+    InfluxBatchBytes,
+    InfluxBatchSeconds,
+    Thermostats,
+    BackfillWindowDays,
+    BackfillConcurrency,
+    ValuePrecision,
+    EcoBeeUrl,
+    SpoolPath,
+    InfluxGzipLevel,
+    StateKeyframeMinutes,
+    Rollups,
+    RollupBaseTemperature,
+    ArchivePath,
 };
 
 std::vector<ConfigFile::Spec> ConfigSpec
@@ -51,13 +81,460 @@ std::vector<ConfigFile::Spec> ConfigSpec
                  {"influxPort", ConfigItem::InfluxPort},
                  {"influxDb", ConfigItem::InfluxDb},
                  {"deleteProcessed", ConfigItem::DeleteProcessed},
+                 {"influxBatchPoints", ConfigItem::InfluxBatchPoints},
+                 {"influxBatchBytes", ConfigItem::InfluxBatchBytes},
+                 {"influxBatchSeconds", ConfigItem::InfluxBatchSeconds},
+                 {"thermostats", ConfigItem::Thermostats},
+                 {"backfillWindowDays", ConfigItem::BackfillWindowDays},
+                 {"backfillConcurrency", ConfigItem::BackfillConcurrency},
+                 {"valuePrecision", ConfigItem::ValuePrecision},
+                 {"ecoBeeUrl", ConfigItem::EcoBeeUrl},
+                 {"spoolPath", ConfigItem::SpoolPath},
+                 {"influxGzipLevel", ConfigItem::InfluxGzipLevel},
+                 {"stateKeyframeMinutes", ConfigItem::StateKeyframeMinutes},
+                 {"rollups", ConfigItem::Rollups},
+                 {"rollupBaseTemperature", ConfigItem::RollupBaseTemperature},
+                 {"archivePath", ConfigItem::ArchivePath},
          }};
 
+/**
+ * A thermostat to report on and the measurement name prefix its data is written under.
+ */
+struct ThermostatName {
+    std::string id{};
+    std::string name{};
+};
+
+/**
+ * @brief Parse a list of thermostats, "id:Name,id:Name". A thermostat without a name is named by its id.
+ * @return The thermostats, or std::nullopt if an id is not numeric or the list is empty.
+ */
+std::optional<std::vector<ThermostatName>> parseThermostats(std::string_view data) {
+    std::vector<ThermostatName> thermostats{};
+    for (auto item : Tokens{data, ','}) {
+        auto colon = item.find(':');
+        auto id = item.substr(0, colon);
+        auto name = colon == std::string_view::npos ? id : item.substr(colon + 1);
+        auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+        if (id.empty() || name.empty() || !std::all_of(id.begin(), id.end(), isDigit))
+            return std::nullopt;
+        thermostats.push_back(ThermostatName{std::string{id}, std::string{name}});
+    }
+    if (thermostats.empty())
+        return std::nullopt;
+    return thermostats;
+}
+
+/**
+ * The time between daemon cycles, the thermostat reports runtime in five minute intervals.
+ */
+using CycleInterval = std::chrono::duration<long, std::ratio<300>>;
+
+/**
+ * How long after an interval boundary a daemon cycle runs, giving the thermostat time to report.
+ */
+static constexpr std::chrono::seconds CycleDelay{30};
+
+/**
+ * How long before it expires the access token is refreshed, two cycles so no cycle starts with a token that
+ * will expire before it ends.
+ */
+static constexpr std::chrono::seconds TokenMargin{2 * CycleInterval{1}};
+
+/**
+ * The span of time of one runtime report row.
+ */
+using ReportInterval = std::chrono::duration<long, std::ratio<300>>;
+
+/**
+ * How a backfill divides and requests the time it is missing.
+ */
+struct BackfillConfig {
+    std::chrono::days window{7};            ///< The span of each report, at most MaximumReportSpan.
+    std::size_t concurrency{4};             ///< The most reports downloading at once.
+};
+
+/**
+ * The state of the poll, report and push cycle. In daemon mode it is kept in memory between cycles and only
+ * written back when it changes.
+ */
+struct Session {
+    std::filesystem::path jsonAccessPath{};
+    std::filesystem::path thermostatPath{};
+    std::string apiKey{};
+    json jsonAccess{};
+    json thermostatJson{};                  ///< The state of each thermostat by id.
+    std::vector<ThermostatName> thermostats{};
+    AccessToken accessToken{};
+    std::unique_ptr<Coverage> coverage{};   ///< The spans of time written for each thermostat.
+    std::unique_ptr<ReportArchive> archive{};   ///< The rows written, replayed by --process.
+};
+
+/**
+ * @brief Save the state of the thermostats.
+ */
+void saveThermostats(const Session &session) {
+    std::ofstream ofs(session.thermostatPath);
+    ofs << session.thermostatJson.dump(4) << '\n';
+    ofs.close();
+}
+
+/**
+ * @brief The state series points last written for a thermostat, {"key": {"value": "...", "time": epoch}}.
+ */
+InfluxBatch::States loadStates(const json &thermostatJson) {
+    InfluxBatch::States states{};
+    if (auto saved = thermostatJson.find("states"); saved != thermostatJson.end() && saved->is_object()) {
+        for (const auto &[key, state] : saved->items())
+            states.emplace(key, InfluxBatch::State{state.value("value", ""),
+                                                   state.value("time", InfluxBatch::Epoch{0})});
+    }
+    return states;
+}
+
+json saveStates(const InfluxBatch::States &states) {
+    auto saved = json::object();
+    for (const auto &[key, state] : states)
+        saved[key] = {{"value", state.value}, {"time", state.time}};
+    return saved;
+}
+
+/**
+ * @brief A rollup for a thermostat if rollups are configured, continuing the open periods saved in its state.
+ */
+std::unique_ptr<Rollup> loadRollup(const json &thermostatJson, const InfluxConfig &influxConfig) {
+    if (!influxConfig.rollups)
+        return {};
+    auto rollup = std::make_unique<Rollup>(influxConfig.rollupBaseTemperature);
+    if (auto saved = thermostatJson.find("rollup"); saved != thermostatJson.end() && saved->is_string())
+        rollup->restore(saved->get_ref<const std::string &>());
+    return rollup;
+}
+
+/**
+ * @brief Update the state of a thermostat from its revisions in a poll.
+ * @param thermostatJson The state of the thermostat.
+ * @param thermostat The revisions, "id:name:connected:thermostat:alerts:runtime:interval".
+ */
+void updateRevisions(json &thermostatJson, std::string thermostat) {
+    size_t idx = 0;
+    for (std::string::size_type pos; (pos = thermostat.find(':')) != std::string::npos; thermostat.erase(0, pos + 1)) {
+        auto token = thermostat.substr(0, pos);
+        switch (idx) {
+            case 0:
+                if (token != thermostatJson["id"])
+                    thermostat.clear();
+                break;
+            case 1:
+                thermostatJson["name"] = token;
+                break;
+            case 2:
+                thermostatJson["connected"] = token == "true";
+                break;
+            case 3:
+                thermostatJson["thermostatRevision"] = token;
+                break;
+            case 4:
+                thermostatJson["alertsRevision"] = token;
+                break;
+            case 5:
+                thermostatJson["runtimeUpdate"] = token != thermostatJson["runtimeRevision"];
+                thermostatJson["runtimeRevision"] = token;
+                break;
+            default:
+                break;
+        }
+        ++idx;
+    }
+    if (idx == 6) {
+        thermostatJson["internalUpdate"] = thermostat != thermostatJson["internalRevision"];
+        thermostatJson["internalRevision"] = thermostat;
+    }
+}
+
+/**
+ * @brief Request one runtime report for a group of thermostats and push it to the database.
+ * @details The report starts at the earliest last data of the group, each thermostat is written by its own
+ * thread with its own batch. The rows written are appended to the archive before the last data moves forward.
+ * @param group The thermostats, at most MaximumSelection, earliest last data first.
+ */
+void reportGroup(Session &session, std::span<const ThermostatName *const> group, const InfluxConfig &influxConfig) {
+    auto &thermostatJson = session.thermostatJson;
+    std::string lastThermostatData = thermostatJson[group.front()->id]["lastData"];
+    auto [startDate, start, endDate, end, lastData] = runtimeIntervals(lastThermostatData);
+
+    std::string selectionMatch{};
+    std::vector<std::unique_ptr<Rollup>> rollups{};     // Destroyed after the batches that write them.
+    std::vector<std::unique_ptr<InfluxBatch>> batches{};
+    std::vector<std::unique_ptr<ReportWindow>> windows{};
+    std::vector<RuntimeReportReader::Target> targets{};
+    for (const auto *thermostat : group) {
+        if (!selectionMatch.empty())
+            selectionMatch.push_back(',');
+        selectionMatch.append(thermostat->id);
+        auto &influx = batches.emplace_back(makeInfluxBatch(influxConfig));
+        influx->setStates(loadStates(thermostatJson[thermostat->id]));
+        influx->setRollup(rollups.emplace_back(loadRollup(thermostatJson[thermostat->id], influxConfig)).get());
+        auto &window = windows.emplace_back(std::make_unique<ReportWindow>(thermostat->id));
+        targets.push_back(RuntimeReportReader::Target{thermostat->id, thermostat->name + ' ', influx.get(),
+                                                      thermostatJson[thermostat->id]["lastData"], window.get()});
+    }
+
+    // The report rows are written while it is parsed.
+    RuntimeReportReader reader{std::move(targets)};
+    auto status = runtimeReport(reader, session.accessToken.mAccessToken,
+                                runtimeReportUrl(DataColumns, true, selectionMatch, startDate, start, endDate, end));
+
+    if (status == ApiStatus::OK) {
+        saveThermostats(session);
+        reader.finish();
+        if (session.archive) {
+            for (const auto &window : windows)
+                session.archive->append(*window);
+        }
+        auto reportStart = Coverage::parseTime(lastThermostatData);
+        for (std::size_t idx = 0; idx < group.size(); ++idx) {
+            const auto *thermostat = group[idx];
+            if (lastData = reader.lastData(thermostat->id); !lastData.empty()) {
+                thermostatJson[thermostat->id]["lastData"] = lastData;
+                if (!batches[idx]->states().empty())
+                    thermostatJson[thermostat->id]["states"] = saveStates(batches[idx]->states());
+                if (rollups[idx])
+                    thermostatJson[thermostat->id]["rollup"] = rollups[idx]->state();
+                if (auto last = Coverage::parseTime(lastData); reportStart && last)
+                    session.coverage->add(thermostat->id,
+                                          Coverage::Span{std::chrono::floor<ReportInterval>(reportStart.value()),
+                                                         last.value() + ReportInterval{1}});
+            }
+        }
+        saveThermostats(session);
+    }
+}
+
+/**
+ * @brief Replace the access token using the refresh token, saving the new token.
+ */
+void refreshToken(Session &session) {
+    std::string refresh = session.jsonAccess["refresh_token"];
+    if (refreshAccessToken(session.jsonAccess, apiUrl() + "/token", session.apiKey, refresh) != ApiStatus::OK)
+        throw ApiError("Can not refresh access token.");
+
+    session.accessToken = AccessToken{session.jsonAccess, std::chrono::system_clock::now()};
+    std::ofstream ofs{session.jsonAccessPath};
+    ofs << session.jsonAccess.dump(4) << '\n';
+    ofs.close();
+}
+
+/**
+ * @brief Poll the thermostat and, if it has new runtime data, request a report and push it to the database.
+ * @return The process exit status.
+ */
+int runCycle(Session &session, const InfluxConfig &influxConfig) {
+    auto &thermostatJson = session.thermostatJson;
+
+    json poll{};
+    if (statusPoll(poll, session.accessToken.mAccessToken) == ApiStatus::TokenExpired) {
+        refreshToken(session);
+        if (statusPoll(poll, session.accessToken.mAccessToken) != ApiStatus::OK) {
+            throw ApiError("API polling error.");
+        }
+    }
+
+    // The revisions of each thermostat, "id:name:connected:thermostat:alerts:runtime:interval".
+    if (auto revisions = poll.find("revisionList"); revisions != poll.end()) {
+        for (const auto &revision : *revisions) {
+            const std::string &thermostat = revision.get_ref<const std::string &>();
+            if (auto state = thermostatJson.find(thermostat.substr(0, thermostat.find(':')));
+                    state != thermostatJson.end())
+                updateRevisions(*state, thermostat);
+        }
+    }
+
+    // Thermostats with new runtime data, earliest first so each report starts where its group needs it.
+    std::vector<const ThermostatName *> updated{};
+    for (const auto &thermostat : session.thermostats) {
+        if (thermostatJson[thermostat.id]["runtimeUpdate"])
+            updated.push_back(&thermostat);
+    }
+    std::stable_sort(updated.begin(), updated.end(), [&thermostatJson](const auto *a, const auto *b) {
+        return thermostatJson[a->id]["lastData"] < thermostatJson[b->id]["lastData"];
+    });
+
+    for (std::size_t first = 0; first < updated.size(); first += MaximumSelection) {
+        reportGroup(session, std::span{updated}.subspan(first, std::min(MaximumSelection, updated.size() - first)),
+                    influxConfig);
+    }
+
+    return 0;
+}
+
+/**
+ * A span of time to request for one thermostat.
+ */
+struct BackfillWindow {
+    const ThermostatName *thermostat{};
+    Coverage::Span span{};
+};
+
+/**
+ * @brief The local midnight starting the day of a time, moved by a number of days.
+ */
+Coverage::Time localMidnight(Coverage::Time time, int days = 0) {
+    auto seconds = std::chrono::system_clock::to_time_t(time);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    local.tm_mday += days;
+    local.tm_hour = local.tm_min = local.tm_sec = 0;
+    local.tm_isdst = -1;    // Let mktime work out if DST was in effect at midnight.
+    return std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::from_time_t(mktime(&local)));
+}
+
+/**
+ * @brief Write one downloaded backfill report and record its progress.
+ * @details The rows written are appended to the archive. The thermostat's last data only moves forward, the span
+ * is recorded up to the last row written.
+ * @param rollup The thermostat's rollup for the backfill, nullptr for none.
+ * @throws ApiError with the report's status if it was refused for a reason other than an expired token.
+ * @return ApiStatus::OK, or ApiStatus::TokenExpired if the token had expired and nothing was written.
+ */
+ApiStatus writeWindow(Session &session, const BackfillWindow &window, std::string report,
+                      const InfluxConfig &influxConfig, Rollup *rollup) {
+    const auto &id = window.thermostat->id;
+    auto influx = makeInfluxBatch(influxConfig);
+    influx->setRollup(rollup);
+
+    // An empty last data leaves the reader's last data empty if the window has no rows.
+    ReportWindow rows{id};
+    RuntimeReportReader reader{{RuntimeReportReader::Target{id, window.thermostat->name + ' ', influx.get(), {},
+                                                            &rows}}};
+    std::istringstream stream{std::move(report)};
+    reader.parse(stream);
+    if (auto status = apiStatus(static_cast<int>(reader.statusCode()), reader.statusMessage());
+            status != ApiStatus::OK)
+        return status;
+    reader.finish();
+    if (session.archive)
+        session.archive->append(rows);
+
+    const auto &lastData = reader.lastData(id);
+    auto last = Coverage::parseTime(lastData);
+    if (!last)
+        return ApiStatus::OK;
+
+    auto &thermostatJson = session.thermostatJson[id];
+    if (lastData > thermostatJson["lastData"].get<std::string>()) {
+        thermostatJson["lastData"] = lastData;
+        saveThermostats(session);
+    }
+    session.coverage->add(id, Coverage::Span{window.span.start, std::min(last.value() + ReportInterval{1},
+                                                                         window.span.end)});
+    return ApiStatus::OK;
+}
+
+/**
+ * @brief Request and write the runtime data missing since a time.
+ * @details The gaps in each thermostat's coverage are divided into windows no longer than the API returns in
+ * one report. Several windows download at once while they are written one at a time, earliest first, and
+ * each window is recorded as soon as it is written. An interrupted backfill continues from the gaps that
+ * remain when it is run again. With rollups each gap is widened to whole local days, so the hours and days
+ * at its edges are written from all their rows rather than from the part that was missing. A window the API
+ * refuses for a reason other than an expired token is reported and skipped, it stays a gap for the next run.
+ * @param from The earliest time to fill.
+ * @return The process exit status, 1 if a window was skipped.
+ */
+int backfill(Session &session, Coverage::Time from, const BackfillConfig &config, const InfluxConfig &influxConfig) {
+    Coverage::Time to = std::chrono::floor<ReportInterval>(std::chrono::system_clock::now());
+    from = std::chrono::floor<ReportInterval>(from);
+
+    std::vector<BackfillWindow> windows{};
+    std::map<std::string, Rollup> rollups{};
+    for (const auto &thermostat : session.thermostats) {
+        std::vector<Coverage::Span> spans{};
+        for (auto gap : session.coverage->gaps(thermostat.id, from, to)) {
+            if (influxConfig.rollups) {
+                gap = {localMidnight(gap.start), std::min(localMidnight(gap.end - ReportInterval{1}, 1), to)};
+                if (!spans.empty() && gap.start <= spans.back().end) {
+                    spans.back().end = std::max(spans.back().end, gap.end);
+                    continue;
+                }
+            }
+            spans.push_back(gap);
+        }
+        for (const auto &span : spans) {
+            for (auto start = span.start; start < span.end; start += config.window)
+                windows.push_back(BackfillWindow{&thermostat, {start, std::min(start + config.window, span.end)}});
+        }
+        if (influxConfig.rollups)
+            rollups.try_emplace(thermostat.id, influxConfig.rollupBaseTemperature);
+    }
+    std::stable_sort(windows.begin(), windows.end(), [](const auto &a, const auto &b) {
+        return a.span.start < b.span.start;
+    });
+
+    auto download = [&session](const BackfillWindow &window) {
+        if (session.accessToken.expiredBy(std::chrono::system_clock::now() + TokenMargin))
+            refreshToken(session);
+        auto [startDate, start, endDate, end] = runtimeIntervals(window.span.start, window.span.end);
+        return std::async(std::launch::async, [token = session.accessToken.mAccessToken,
+                url = runtimeReportUrl(DataColumns, true, window.thermostat->id, startDate, start, endDate, end)]() {
+            std::string report{};
+            fetchRuntimeReport(report, token, url);
+            return report;
+        });
+    };
+
+    // Downloads run ahead of the writing by at most the concurrency, each window is written in turn.
+    std::deque<std::future<std::string>> downloads{};
+    std::size_t next{0};
+    bool skipped{false};
+    for (const auto &window : windows) {
+        while (next < windows.size() && downloads.size() < config.concurrency)
+            downloads.push_back(download(windows[next++]));
+
+        auto report = downloads.front().get();
+        downloads.pop_front();
+        auto rollup = rollups.find(window.thermostat->id);
+        auto *windowRollup = rollup == rollups.end() ? nullptr : &rollup->second;
+        auto write = [&](std::string windowReport) -> std::optional<ApiStatus> {
+            try {
+                return writeWindow(session, window, std::move(windowReport), influxConfig, windowRollup);
+            } catch (const ApiError &e) {
+                std::cerr << window.thermostat->name << ' ' << Coverage::formatTime(window.span.start) << " -- "
+                          << Coverage::formatTime(window.span.end) << " skipped: " << e.what() << '\n';
+                return std::nullopt;
+            }
+        };
+
+        auto status = write(std::move(report));
+        if (status == ApiStatus::TokenExpired) {
+            refreshToken(session);
+            status = write(download(window).get());
+            if (status == ApiStatus::TokenExpired)
+                throw ApiError("Can not refresh access token.");
+        }
+        if (!status) {
+            skipped = true;
+            continue;
+        }
+        std::cout << window.thermostat->name << ' ' << Coverage::formatTime(window.span.start) << " -- "
+                  << Coverage::formatTime(window.span.end) << '\n';
+    }
+
+    return skipped ? 1 : 0;
+}
+
 int main(int argc, char **argv) {
     static constexpr std::string_view ConfigOption = "--config";
     static constexpr std::string_view ProcessOption = "--process";
+    static constexpr std::string_view SinceOption = "--since";
+    static constexpr std::string_view DaemonOption = "--daemon";
+    static constexpr std::string_view BackfillOption = "--backfill";
 
     InfluxConfig influxConfig{};
+    BackfillConfig backfillConfig{};
+    std::vector<ThermostatName> thermostats{{std::string{Thermostat}, "Home"}};
+    std::optional<std::filesystem::path> spoolPath{};
+    std::optional<std::filesystem::path> archivePath{};
     InputParser inputParser{argc, argv};
 
     xdg::Environment &environment{xdg::Environment::getEnvironment(false)};
@@ -110,6 +587,91 @@ int main(int argc, char **argv) {
                     });
                     validValue = influxConfig.influxDb.has_value();
                     break;
+                case ConfigItem::InfluxBatchPoints:
+                    if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() > 0) {
+                        influxConfig.influxLimits.maxPoints = static_cast<std::size_t>(value.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::InfluxBatchBytes:
+                    if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() > 0) {
+                        influxConfig.influxLimits.maxBytes = static_cast<std::size_t>(value.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::InfluxBatchSeconds:
+                    if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() >= 0) {
+                        influxConfig.influxLimits.maxAge = std::chrono::seconds{value.value()};
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::InfluxGzipLevel:
+                    if (auto value = ConfigFile::safeConvert<long>(data);
+                            value.has_value() && value.value() >= 0 && value.value() <= GzipEncoder::MaximumLevel) {
+                        influxConfig.influxGzipLevel = static_cast<int>(value.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::StateKeyframeMinutes:
+                    if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() >= 0) {
+                        influxConfig.influxLimits.stateKeyframe = std::chrono::minutes{value.value()};
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::Rollups:
+                    if (auto value = ConfigFile::parseBoolean(data); value) {
+                        influxConfig.rollups = value.value();
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::RollupBaseTemperature:
+                    if (auto value = parseNumber(data); value) {
+                        influxConfig.rollupBaseTemperature = value.value();
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::Thermostats:
+                    if (auto value = parseThermostats(data); value) {
+                        thermostats = std::move(value.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::EcoBeeUrl:
+                    if (auto value = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == ':' || c == '/' || c == '.' || c == '-';
+                        }); value) {
+                        setApiUrl(value.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::ValuePrecision:
+                    if (auto value = ConfigFile::safeConvert<long>(data);
+                            value.has_value() && value.value() >= -1 && value.value() <= 9) {
+                        influxConfig.influxLimits.precision = static_cast<int>(value.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::SpoolPath:
+                    spoolPath = ConfigFile::parseFilesystemPath(data);
+                    validValue = spoolPath.has_value();
+                    break;
+                case ConfigItem::ArchivePath:
+                    archivePath = ConfigFile::parseFilesystemPath(data);
+                    validValue = archivePath.has_value();
+                    break;
+                case ConfigItem::BackfillWindowDays:
+                    if (auto value = ConfigFile::safeConvert<long>(data);
+                            value.has_value() && value.value() > 0 && value.value() <= MaximumReportSpan.count()) {
+                        backfillConfig.window = std::chrono::days{value.value()};
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::BackfillConcurrency:
+                    if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() > 0) {
+                        backfillConfig.concurrency = static_cast<std::size_t>(value.value());
+                        validValue = true;
+                    }
+                    break;
                 default:
                     break;
             }
@@ -121,14 +683,68 @@ int main(int argc, char **argv) {
     }
     configFile.close();
 
+    // Points are synced to the spool before the last data moves forward, the replayer writes them to the
+    // database and makes a last attempt to drain the spool when it is destroyed.
+    Spool spool{spoolPath.value_or(environment.get_configuration_paths("spool").front())};
+    SpoolReplayer replayer{spool, InfluxBatch::httpTransport(influxConfig.influxHost.value(),
+                                                             influxConfig.influxTLS.value(),
+                                                             influxConfig.influxPort.value(),
+                                                             influxConfig.influxDb.value(),
+                                                             influxConfig.influxGzipLevel),
+                           std::max(influxConfig.influxLimits.maxAge, std::chrono::seconds{1})};
+    influxConfig.spool = &spool;
+
+    // Batches are written to the spool by a writer thread while reports are parsed. A failed write fails the
+    // rest of the run, the daemon has a writer for each cycle so a failed cycle does not fail those after it.
+    AsyncWriter writer{influxTransport(influxConfig)};
+    influxConfig.writer = &writer;
+
     if (inputParser.cmdOptionExists(ProcessOption)) {
         auto dataPath = firstValidFile(environment.get_configuration_paths(inputParser.getCmdOption(ProcessOption)));
-        std::ifstream ifs{dataPath};
-        auto report = json::parse(ifs);
+
+        // An archive is replayed one thread per thermostat, --since YYYY-MM-DD replays the rows from a local date.
+        if (ArchiveReader::isArchive(dataPath)) {
+            auto from = std::numeric_limits<LocalSeconds>::min();
+            if (inputParser.cmdOptionExists(SinceOption)) {
+                auto date = inputParser.getCmdOption(SinceOption);
+                auto since = localSeconds(date, "00:00:00");
+                if (!since) {
+                    std::cerr << "Invalid since date: " << date << '\n';
+                    return 1;
+                }
+                from = since.value();
+            }
+
+            ArchiveReader archive{dataPath};
+            std::vector<std::future<void>> replays{};
+            for (const auto &thermostat : thermostats) {
+                replays.push_back(std::async(std::launch::async, [&archive, &influxConfig, &thermostat, from]() {
+                    auto influx = makeInfluxBatch(influxConfig);
+                    SeriesKeys seriesKeys{thermostat.name + ' '};
+                    archive.replay(thermostat.id, seriesKeys, *influx, from);
+                    influx->flush();
+                }));
+            }
+            for (auto &replay : replays)
+                replay.get();
+            return 0;
+        }
+
+        std::ifstream ifs{dataPath, std::ios::binary};
+
+        // A saved report holds part of the hours and days at its edges, it is written without rollups so it does
+        // not replace the aggregates of those periods with partial ones.
+        std::vector<std::unique_ptr<InfluxBatch>> batches{};
+        std::vector<RuntimeReportReader::Target> targets{};
+        for (const auto &thermostat : thermostats) {
+            auto &influx = batches.emplace_back(makeInfluxBatch(influxConfig));
+            targets.push_back(RuntimeReportReader::Target{thermostat.id, thermostat.name + ' ', influx.get(), {}});
+        }
+        RuntimeReportReader reader{std::move(targets)};
+        reader.parse(ifs);
         ifs.close();
-        std::string lastDate{};
-        [[maybe_unused]] auto lastData = processRuntimeData(report, influxConfig, lastDate);
-        exit(0);
+        reader.finish();
+        return 0;
     }
 
     if (appAuthPath.empty() || jsonAccessPath.empty()) {
@@ -139,94 +755,79 @@ int main(int argc, char **argv) {
     auto appAuth = json::parse(ifs);
     ifs.close();
 
+    Session session{};
+    session.jsonAccessPath = jsonAccessPath;
+    session.thermostatPath = thermostatPath;
+    session.apiKey = appAuth["API_Key"];
+    session.coverage = std::make_unique<Coverage>(environment.get_configuration_paths("coverage.txt").front());
+    session.archive = std::make_unique<ReportArchive>(
+            archivePath.value_or(environment.get_configuration_paths("reports.archive").front()));
+
     ifs.open(jsonAccessPath);
-    auto jsonAccess = json::parse(ifs);
+    session.jsonAccess = json::parse(ifs);
     ifs.close();
 
-    ifs.open(thermostatPath);
-    auto thermostatJson = json::parse(ifs);
-    ifs.close();
+    // The saved token was received when its file was written.
+    session.accessToken = AccessToken{session.jsonAccess, std::chrono::file_clock::to_sys(
+            std::filesystem::last_write_time(jsonAccessPath))};
 
-    std::string ecoBeeTokenURL{"https://api.ecobee.com/token"};
-    std::string apiKey = appAuth["API_Key"];
-    std::string token = jsonAccess["refresh_token"];
-    std::string access = jsonAccess["access_token"];
+    // The state of each thermostat by id. A state saved before more than one thermostat was supported is
+    // the state of its id. A thermostat without a state starts a day ago.
+    if (thermostatPath.empty()) {
+        session.thermostatPath = environment.get_configuration_paths("thermostat.json").front();
+        session.thermostatJson = json::object();
+    } else {
+        ifs.open(thermostatPath);
+        session.thermostatJson = json::parse(ifs);
+        ifs.close();
+    }
+    if (session.thermostatJson.contains("id")) {
+        std::string id = session.thermostatJson["id"];
+        session.thermostatJson = json{{id, session.thermostatJson}};
+    }
 
-    json poll{};
-    if (statusPoll(poll, access) == ApiStatus::TokenExpired) {
-        if (refreshAccessToken(jsonAccess, ecoBeeTokenURL, apiKey, token) == ApiStatus::OK) {
-            std::ofstream ofs{jsonAccessPath};
-            ofs << jsonAccess.dump(4) << '\n';
-            ofs.close();
-            access = jsonAccess["access_token"];
-        } else {
-            std::cerr << "Can not refresh access token.\n";
-            return 1;
-        }
-        if (statusPoll(poll, access) != ApiStatus::OK) {
-            throw ApiError("API polling error.");
+    session.thermostats = thermostats;
+    for (const auto &thermostat : thermostats) {
+        if (!session.thermostatJson.contains(thermostat.id)) {
+            auto dayAgo = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now() - std::chrono::days{1});
+            char buf[32];
+            strftime(buf, sizeof(buf), std::string{DateTimeFormat}.c_str(), gmtime(&dayAgo));
+            session.thermostatJson[thermostat.id] = {{"id", thermostat.id}, {"lastData", buf}, {"runtimeUpdate", true}};
         }
     }
-    std::string thermostat{};
 
-    size_t idx = 0;
-    for (std::string::size_type pos; (pos = thermostat.find(':')) != std::string::npos; thermostat.erase(0, pos + 1)) {
-        token = thermostat.substr(0, pos);
-        switch (idx) {
-            case 0:
-                if (token != thermostatJson["id"])
-                    thermostat.clear();
-                break;
-            case 1:
-                thermostatJson["name"] = token;
-                break;
-            case 2:
-                thermostatJson["connected"] = token == "true";
-                break;
-            case 3:
-                thermostatJson["thermostatRevision"] = token;
-                break;
-            case 4:
-                thermostatJson["alertsRevision"] = token;
-                break;
-            case 5:
-                thermostatJson["runtimeUpdate"] = token != thermostatJson["runtimeRevision"];
-                thermostatJson["runtimeRevision"] = token;
-                break;
-            default:
-                break;
+    // Fill the gaps since a date, "YYYY-MM-DD" GMT.
+    if (inputParser.cmdOptionExists(BackfillOption)) {
+        auto date = inputParser.getCmdOption(BackfillOption);
+        auto from = Coverage::parseTime(ysh::StringComposite(date, "T00:00:00Z"));
+        if (!from) {
+            std::cerr << "Invalid backfill date: " << date << '\n';
+            return 1;
         }
-        ++idx;
-    }
-    if (idx == 6) {
-        thermostatJson["internalUpdate"] = thermostat != thermostatJson["internalRevision"];
-        thermostatJson["internalRevision"] = thermostat;
+        return backfill(session, from.value(), backfillConfig, influxConfig);
     }
 
-    if (thermostatJson["runtimeUpdate"]) {
-        std::string lastThermostatData = thermostatJson["lastData"];
-        auto [startDate, start, endDate, end, lastData] = runtimeIntervals(lastThermostatData);
-        auto fileName = ysh::StringComposite(startDate, ':', start, "--", endDate, ':', end, ".json");
-        json report{};
-        if (runtimeReport(report, jsonAccess["access_token"],
-                          runtimeReportUrl(DataColumns, true, startDate, start, endDate, end)) == ApiStatus::OK) {
-            std::ofstream ofs(thermostatPath);
-            ofs << thermostatJson.dump(4) << '\n';
-            ofs.close();
-            auto dataPath = environment.get_configuration_paths(fileName).front();
-            ofs.open(dataPath);
-            ofs << report.dump(4) << '\n';
-            ofs.close();
-            lastData = processRuntimeData(report, influxConfig, lastThermostatData);
-            if (!lastData.empty()) {
-                thermostatJson["lastData"] = lastData;
-                ofs.open(thermostatPath);
-                ofs << thermostatJson.dump(4) << '\n';
-                ofs.close();
-                remove(dataPath);
+    if (!inputParser.cmdOptionExists(DaemonOption))
+        return runCycle(session, influxConfig);
+
+    // Stay resident, refreshing the token before it expires and running a cycle after each interval boundary.
+    for (;;) {
+        try {
+            if (session.accessToken.expiredBy(std::chrono::system_clock::now() + TokenMargin))
+                refreshToken(session);
+            {
+                AsyncWriter cycleWriter{influxTransport(influxConfig)};
+                auto cycleConfig = influxConfig;
+                cycleConfig.writer = &cycleWriter;
+                runCycle(session, cycleConfig);
             }
+            replayer.notify();
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << '\n';
         }
-    }
 
-    return 0;
-}
\ No newline at end of file
+        auto now = std::chrono::system_clock::now();
+        std::this_thread::sleep_until(std::chrono::floor<CycleInterval>(now - CycleDelay) + CycleInterval{1} +
+                                      CycleDelay);
+    }
+}
@@ -13,63 +13,135 @@
  * @date 30/01/23
  */
 
-#include <Info.hpp>
 #include <ranges>
-#include <fstream>
 #include <ctime>
 #include <sstream>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <utility>
+#include <thread>
 #include <date/tz.h>
 #include "Api.h"
 #include "nlohmann/json.hpp"
-#include "InfluxPush.h"
+#include "InfluxBatch.h"
+#include "RuntimePlan.h"
+#include "RuntimeReportReader.h"
+#include "ChunkQueue.h"
+#include "HttpClient.h"
+#include "Spool.h"
+#include "AsyncWriter.h"
 
 namespace ecoBee {
-    ApiStatus runtimeReport(nlohmann::json &data, const std::string &token, const std::string &url) {
-        std::stringstream response{};
-        cURLpp::Cleanup cleaner;
-        cURLpp::Easy request;
+    namespace {
+        std::string baseUrl{EcoBeeApiUrl};
 
-        request.setOpt(new cURLpp::Options::Url(url));
-        request.setOpt(new cURLpp::Options::Verbose(false));
+        /**
+         * @brief The API request headers for an access token, rebuilt only when the token changes.
+         */
+        std::shared_ptr<const HttpHeaders> authorizedHeaders(const std::string &token) {
+            static std::mutex mutex{};
+            static std::string headersToken{};
+            static std::shared_ptr<const HttpHeaders> headers{};
+
+            std::lock_guard lock{mutex};
+            if (!headers || token != headersToken) {
+                headers = std::make_shared<const HttpHeaders>(HttpHeaders{
+                        "Content-Type: text/json;charset=UTF-8",
+                        ysh::StringComposite("Authorization: Bearer ", token)});
+                headersToken = token;
+            }
+            return headers;
+        }
+    }
+
+    InfluxBatch::Transport influxTransport(const InfluxConfig &config) {
+        if (config.spool)
+            return config.spool->transport();
+        return InfluxBatch::httpTransport(config.influxHost.value(), config.influxTLS.value(),
+                                          config.influxPort.value(), config.influxDb.value(),
+                                          config.influxGzipLevel);
+    }
 
-        std::list<std::string> header;
-        header.emplace_back("content-type: text/json;charset=UTF-8");
-        header.emplace_back(ysh::StringComposite("Authorization: Bearer ", token));
-        request.setOpt(new cURLpp::Options::HttpHeader(header));
+    std::unique_ptr<InfluxBatch> makeInfluxBatch(const InfluxConfig &config) {
+        if (config.writer)
+            return std::make_unique<InfluxBatch>(*config.writer, config.influxLimits);
+        return std::make_unique<InfluxBatch>(influxTransport(config), config.influxLimits);
+    }
 
-        request.setOpt(new curlpp::options::WriteStream(&response));
+    void setApiUrl(std::string_view url) {
+        baseUrl = url;
+    }
+
+    const std::string &apiUrl() {
+        return baseUrl;
+    }
 
-        request.perform();
-        if (auto code = curlpp::infos::ResponseCode::get(request); code != 200 && code != 500) {
+    ApiStatus runtimeReport(RuntimeReportReader &reader, const std::string &token, const std::string &url) {
+        auto headers = authorizedHeaders(token);
+
+        // The body is parsed on this thread while it downloads on another. The sink returning false aborts
+        // the transfer once the parser has given up.
+        ChunkQueue body{};
+        bool aborted{false};
+        auto sink = [&body, &aborted](std::string_view data) {
+            aborted = !body.push(data.data(), data.size());
+            return !aborted;
+        };
+
+        long code{0};
+        std::exception_ptr transferError{};
+        std::jthread transfer{[&]() {
+            try {
+                code = HttpClient::shared().get(url, *headers, sink);
+            } catch (...) {
+                transferError = std::current_exception();
+            }
+            body.close();
+        }};
+
+        std::exception_ptr parseError{};
+        try {
+            std::istream stream{&body};
+            reader.parse(stream);
+        } catch (...) {
+            parseError = std::current_exception();
+        }
+        body.abandon();
+        transfer.join();
+
+        // A failed transfer truncates the body so it is reported before the parse error it causes, unless
+        // the transfer was aborted because parsing failed.
+        if (transferError && !aborted)
+            std::rethrow_exception(transferError);
+        if (!transferError && code != 200 && code != 500) {
             throw HtmlError(ysh::StringComposite("HTML error code: ", code));
         }
+        if (parseError)
+            std::rethrow_exception(parseError);
 
-        data = nlohmann::json::parse(response);
-        return apiStatus(data["status"]["code"], data["status"]["message"]);
+        return apiStatus(static_cast<int>(reader.statusCode()), reader.statusMessage());
     }
 
-    ApiStatus thermostat(const std::string &token) {
-        std::stringstream response{};
-        cURLpp::Cleanup cleaner;
-        cURLpp::Easy request;
-
-        auto url = R"(https://api.ecobee.com/1/thermostat?format=json&body={"selection":{"selectionType":"registered",)"
-                   R"(selectionMatch":"","includeRuntime":true}})";
+    void fetchRuntimeReport(std::string &report, const std::string &token, const std::string &url) {
+        report.clear();
+        if (auto code = HttpClient::shared().get(url, *authorizedHeaders(token), report); code != 200 && code != 500) {
+            throw HtmlError(ysh::StringComposite("HTML error code: ", code));
+        }
+    }
 
-        request.setOpt(new cURLpp::Options::Url(url));
-        request.setOpt(new cURLpp::Options::Verbose(false));
+    AccessToken::AccessToken(const nlohmann::json &token, std::chrono::system_clock::time_point received)
+            : mAccessToken(token.value("access_token", "")), mTokenType(token.value("token_type", "")),
+              mScope(token.value("scope", "")), mRefreshToke(token.value("refresh_token", "")),
+              mExpiresIn(token.value("expires_in", 0u)), mExpires(received + std::chrono::seconds{mExpiresIn}) {}
 
-        std::list<std::string> header;
-        header.emplace_back("content-type: text/json");
-        header.emplace_back(ysh::StringComposite("Authorization: Bearer ", token));
-        request.setOpt(new cURLpp::Options::HttpHeader(header));
+    ApiStatus thermostat(const std::string &token) {
+        std::string response{};
 
-        request.setOpt(new curlpp::options::WriteStream(&response));
+        auto url = ysh::StringComposite(apiUrl(), R"(/1/thermostat?format=json&body={"selection":{)",
+                                        R"("selectionType":"registered","selectionMatch":"","includeRuntime":true}})");
 
-        request.perform();
-        if (auto code = curlpp::infos::ResponseCode::get(request); code != 200) {
+        if (auto code = HttpClient::shared().get(url, *authorizedHeaders(token), response); code != 200) {
             throw HtmlError(ysh::StringComposite("HTML error code: ", code));
         }
 
@@ -88,30 +160,16 @@ namespace ecoBee {
      */
     ApiStatus refreshAccessToken(nlohmann::json &accessToken, const std::string &url, const std::string &apiKey,
                                  const std::string &token) {
+        static const HttpHeaders FormHeaders{"Content-Type: application/x-www-form-urlencoded"};
+
         auto postData = ysh::StringComposite("grant_type=refresh_token&&code=", token, "&client_id=", apiKey);
-        std::stringstream response{};
-        cURLpp::Cleanup cleaner;
-        cURLpp::Easy request;
-        request.setOpt(new cURLpp::Options::Url(url));
-        request.setOpt(new cURLpp::Options::Verbose(false));
-
-        std::list<std::string> header;
-        header.emplace_back("Content-Type: application/x-www-form-urlencoded");
-        request.setOpt(new cURLpp::Options::HttpHeader(header));
-
-        request.setOpt(new cURLpp::Options::PostFieldSize(static_cast<long>(postData.length())));
-        request.setOpt(new cURLpp::Options::PostFields(postData));
-        request.setOpt(new curlpp::options::WriteStream(&response));
-
-        request.perform();
-        if (auto code = curlpp::infos::ResponseCode::get(request); code != 200) {
+        std::string response{};
+
+        if (auto code = HttpClient::shared().post(url, FormHeaders, postData, response); code != 200) {
             throw HtmlError(ysh::StringComposite("HTML error code: ", code));
         }
 
         accessToken = nlohmann::json::parse(response);
-        std::ofstream ofs("/home/richard/.config/ecoBeeApi/response.json");
-        ofs << accessToken.dump(4) << '\n';
-        ofs.close();
         return ApiStatus::OK;
     }
 
@@ -127,22 +185,12 @@ namespace ecoBee {
      * @return ApiStatus::OK if the poll succeeds, ApiStatus::Expired if the access token is expired.
      */
     ApiStatus statusPoll(nlohmann::json &poll, const std::string &token) {
-        std::stringstream response{};
-        cURLpp::Cleanup cleaner;
-        cURLpp::Easy request;
-        request.setOpt(new cURLpp::Options::Url(R"(https://api.ecobee.com/1/thermostatSummary?json=)"
-            R"({"selection":{"selectionType":"registered","selectionMatch":"","includeEquipmentStatus":true}})"));
-        request.setOpt(new cURLpp::Options::Verbose(false));
-
-        std::list<std::string> header;
-        header.emplace_back("Content-Type: text/json");
-
-        header.emplace_back(ysh::StringComposite("Authorization: Bearer ", token));
-        request.setOpt(new cURLpp::Options::HttpHeader(header));
-        request.setOpt(new curlpp::options::WriteStream(&response));
-
-        request.perform();
-        if (auto code = curlpp::infos::ResponseCode::get(request); code != 200 && code != 500) {
+        auto url = ysh::StringComposite(apiUrl(), R"(/1/thermostatSummary?json=)",
+            R"({"selection":{"selectionType":"registered","selectionMatch":"","includeEquipmentStatus":true}})");
+        std::string response{};
+
+        if (auto code = HttpClient::shared().get(url, *authorizedHeaders(token), response);
+                code != 200 && code != 500) {
             throw HtmlError(ysh::StringComposite("HTML error code: ", code));
         }
 
@@ -157,8 +205,9 @@ namespace ecoBee {
         time_t epoch;
         ::time(&epoch);
 
-        // Convert the provided local time to GMT.
-        localDateTime = *(localtime(&epoch));
+        // Convert the provided local time to GMT. Rows are converted on several threads, so the reentrant
+        // conversions are used.
+        localtime_r(&epoch, &localDateTime);
         std::string dateTimeString = date;
         dateTimeString.append("T").append(time);
 
@@ -173,8 +222,9 @@ namespace ecoBee {
 
         // Complete conversion to GMT.
         epoch = ::mktime(&dateTime);
+        std::tm gmtDateTime{};
         char buf[32];
-        strftime(buf, 31, format.c_str(), gmtime(&epoch));
+        strftime(buf, 31, format.c_str(), gmtime_r(&epoch, &gmtDateTime));
         return std::string{buf};
     }
 
@@ -207,66 +257,20 @@ namespace ecoBee {
         return {startTime,startInt,endTime,endInt,std::string{buf}};
     }
 
-    /**
-     * @brief A concept for a delimiter which can be a string or a character.
-     * @tparam Delim The type of delimiter
-     */
-    template<class Delim> concept TokenDelimiter = requires {
-        std::is_same_v<Delim,std::string> || std::is_same_v<Delim,char>;
-    };
-
-    /**
-     * @brief Iteratively tokenize a string by a delimiter.
-     * @details See tokenVector() for an example usage.
-     * @tparam Delim The type of delimiter.
-     * @param source The source string.
-     * @param delim The delimiter value.
-     * @return A tuple with the found token (or empty), the remainder of the source (or empty), and true when done.
-     */
-    template<class Delim>
-    requires TokenDelimiter<Delim>
-    std::tuple<std::string,std::string,bool> tokenizeString(const std::string& source, Delim delim) {
-        size_t delimSize{};
-
-        if (source.empty())
-            return {std::string{},std::string{},false};
-
-        if constexpr (std::is_same_v<Delim,char>)
-            delimSize = 1;
-        else
-            delimSize = delim.size();
-
-        auto pos0 = source.find(delim);
-        if (pos0 == std::string::npos)
-            return {source,std::string{},true};
-        if (pos0 == 0) {
-            auto rest = source.substr(pos0 + delimSize);
-            auto pos1 = rest.find(delim);
-            if (pos1 == 0)
-                return {std::string{}, rest, true};
-            if (pos1 == std::string::npos)
-                return {rest, std::string{}, true};
-            return {rest.substr(0,pos1), rest.substr(pos1), true};
-        }
-        return {source.substr(0,pos0), source.substr(pos0), true};
-    }
-
-    /**
-     * @brief Decompose a delimited string into tokens in a std::vector<std::string>.
-     * @tparam Delim The delimiter type.
-     * @param source The source std::string.
-     * @param delim The delimiter value.
-     * @return A possibly empty std::vector<std::string>
-     */
-    template<class Delim>
-    requires TokenDelimiter<Delim>
-    std::vector<std::string> tokenVector(const std::string& source, Delim delim) {
-        std::vector<std::string> result{};
-        for (auto token = tokenizeString(source,delim); get<2>(token); token = tokenizeString(get<1>(token),delim)){
-            auto v = get<0>(token);
-            result.emplace_back(get<0>(token));
-        }
-        return result;
+    std::tuple<std::string, std::string, std::string, std::string>
+    runtimeIntervals(std::chrono::sys_seconds start, std::chrono::sys_seconds end) {
+        // The report end interval is inclusive, so the span ends with the interval before end.
+        auto interval = [](std::chrono::sys_seconds time) {
+            auto epoch = static_cast<time_t>(time.time_since_epoch().count());
+            std::tm dateTime{};
+            gmtime_r(&epoch, &dateTime);
+            char buf[16];
+            strftime(buf, sizeof(buf), "%Y-%m-%d", &dateTime);
+            return std::pair{std::string{buf}, std::to_string((dateTime.tm_hour * 60 + dateTime.tm_min) / 5)};
+        };
+        auto [startDate, startInt] = interval(start);
+        auto [endDate, endInt] = interval(end - std::chrono::minutes{5});
+        return {startDate, startInt, endDate, endInt};
     }
 
     /**
@@ -278,206 +282,30 @@ namespace ecoBee {
      * @return A std::string with the GMT time string of last data row processed. Empty if no data processed.
      */
     std::string processRuntimeData(const nlohmann::json &data, const InfluxConfig &config, std::string &lastData) {
+        auto influx = makeInfluxBatch(config);
+        return processRuntimeData(data, *influx, lastData);
+    }
+
+    std::string processRuntimeData(const nlohmann::json &data, InfluxBatch &influx, std::string &lastData) {
         size_t reportRowCount = data["reportList"][0]["rowCount"];
         std::string newLastTime{lastData};
-        InfluxPush influx(config.influxHost.value(), config.influxTLS.value(), config.influxPort.value(), config.influxDb.value());
+        SeriesKeys seriesKeys{"Home "};
 
-        // Tokenize report column titles.
-        auto columnList = tokenVector(data["columns"], ',');
-        std::vector<std::string> sensorList{};
-        std::map<std::string,Sensor> sensors{};
-
-        // Tokenize sensor column titles which are sensor ID strings.
-        for (auto &column : data["sensorList"][0]["columns"]) {
-            sensorList.emplace_back(column);
-        }
-
-        // Gather the sensor structures and map them to their IDs
-        for (auto &sensor : data["sensorList"][0]["sensors"]) {
-            sensors.emplace(sensor["sensorId"],Sensor{sensor["sensorId"],sensor["sensorName"],sensor["sensorType"],sensor["sensorUsage"]});
-        }
+        // Classify the report columns and sensors once.
+        RuntimePlan plan{data, seriesKeys};
 
         // Process each row of returned data.
+        const auto &rowList = data["reportList"][0]["rowList"];
+        const auto &sensorData = data["sensorList"][0]["data"];
         for (size_t idx = 0; idx < reportRowCount; ++idx) {
-            nlohmann::json reportJson{};
-            auto reportVector = tokenVector(data["reportList"][0]["rowList"][idx],',');
-            auto sensorVector = tokenVector(data["sensorList"][0]["data"][idx],',');
-
-            // Process thermostat/system data
-            if (columnList.size() + 2 == reportVector.size()) {
-
-                /**
-                 * The data row is ready to use, sent to an InfluxDB for example. If the reportJson structure is
-                 * empty, the CSV row had no data.
-                 */
-                if (reportVector.at(2).empty() || sensorVector.at(2).empty()) {
-                    continue;   // Skipp lines with incomplete data but continue scan in case more data follows.
-                }
-                newLastTime = localToGMT(reportVector[0], reportVector[1]);
-
-                /**
-                 * Categorize data into:
-                 *  - Operations time data. These are data that indicate how long during a 5 minute interval
-                 *  equipment was operating or operating in a specific mode.
-                 *  - Operations state data. The operating mode or state at the beginning of the interval.
-                 *  - Temperatures.
-                 *  - Humidity.
-                 */
-                for(size_t colIdx = 0; colIdx < columnList.size(); ++colIdx) {
-                    if (OperationTimeParam.find(columnList[colIdx]) != std::string_view::npos)
-                        reportJson["operations"]["time"][columnList[colIdx]] = reportVector[colIdx + 2];
-                    else if (OperationStateParam.find(columnList[colIdx]) != std::string_view::npos)
-                        reportJson["operations"]["state"][columnList[colIdx]] = reportVector[colIdx + 2];
-                    else if (columnList[colIdx].find("zoneHeatTemp") != std::string::npos ||
-                            columnList[colIdx].find("zoneCoolTemp") != std::string::npos)
-                        reportJson["operations"][columnList[colIdx]] = reportVector[colIdx + 2];
-                    else if (columnList[colIdx].find("Humidity") != std::string::npos)
-                        reportJson["humidity"][columnList[colIdx]] = reportVector[colIdx + 2];
-                    else if (columnList[colIdx].find("Temp") != std::string::npos)
-                        reportJson["temperature"][columnList[colIdx]] = reportVector[colIdx + 2];
-                    else
-                        reportJson["data"][columnList[colIdx]] = reportVector[colIdx + 2];
-                }
-            }
-
-            /**
-             * Process sensor data, only temperatures, humanities and pressures are handled in this version.
-             * Occupancy is ignored.
-             */
-            if (sensorList.size() == sensorVector.size()) {
-                for(size_t colIdx = 2; colIdx < sensorList.size(); ++colIdx) {
-                    auto sensor = sensors.find(sensorList[colIdx]);
-                    if (sensor != sensors.end()) {
-                        switch (sensor->second.type) {
-                            case Sensor::temperature:
-                                reportJson["temperature"][sensor->second.name] = sensorVector[colIdx];
-                                break;
-                            case Sensor::humidity:
-                                reportJson["humidity"][sensor->second.name] = sensorVector[colIdx];
-                                break;
-                            case Sensor::airPressure:
-                                reportJson["airPressure"][sensor->second.name] = sensorVector[colIdx];
-                                break;
-                            default:
-                                break;
-                        }
-                    }
-                }
-            }
-            influxPush(reportJson, influx, reportVector[0], reportVector[1]);
+            if (auto rowTime = plan.writeRow(influx, rowList[idx].get_ref<const std::string&>(),
+                                             sensorData[idx].get_ref<const std::string&>()); rowTime)
+                newLastTime = std::move(rowTime.value());
         }
 
+        // Write the rest of the batch, a failure throws before lastData is advanced.
+        influx.flush();
         return newLastTime;
     }
 
-    std::string escapeHeader(const std::string& hdr) {
-        auto workingHdr = hdr;
-        if (auto pos = workingHdr.rfind(" ("); pos != std::string::npos) {
-            workingHdr = workingHdr.substr(0, pos);
-        }
-
-        if (!workingHdr.empty())
-            for( auto pos = workingHdr.rfind(' '); pos > 0 && pos != std::string::npos; pos = workingHdr.rfind(' ', pos)) {
-                workingHdr.insert(pos, 1, '\\');
-            }
-
-        return workingHdr;
-    }
-
-    std::string FtoC(const std::string& f) {
-        if (f.empty())
-            return f;
-        return std::to_string((atof(f.c_str()) - 32.f)  * 5.f/9.f);
-    }
-
-    std::string hectoPascals(const std::string& s) {
-        if (s.empty())
-            return s;
-        return std::to_string(atof(s.c_str()) / 100.f);
-    }
-
-    void timeBasedOperation(InfluxPush &influx, const std::string& name, const std::string& data, const std::string& time,
-                            int seconds, bool state);
-
-    void influxPush(nlohmann::json &row, InfluxPush &influx, const std::string &date, const std::string &time) {
-        const static std::string prefix{"Home "};
-        const static std::optional<std::string>True{"true"};
-        const static std::optional<std::string>False{"false"};
-
-        influx.newMeasurements();
-        influx.setMeasurementEpoch(date, time);
-        bool dataWritten = false;
-
-        for (const auto& item : row["humidity"].items()) {
-            if (!item.value().empty())
-                dataWritten |= influx.addMeasurement(prefix, escapeHeader(item.key()), item.value());
-        }
-
-        for (const auto& item : row["temperature"].items()) {
-            dataWritten |= influx.addMeasurement(prefix, escapeHeader(item.key()), FtoC(item.value()));
-        }
-
-        for (const auto& item : row["airPressure"].items()) {
-            dataWritten |= influx.addMeasurement(prefix, escapeHeader(item.key()), hectoPascals(item.value()));
-        }
-
-        if (row["operations"]["state"]["HVACmode"] == "heat") {
-            if (!row["operations"]["zoneHeatTemp"].empty())
-                dataWritten += influx.addMeasurement(prefix, "SetPoint", FtoC(row["operations"]["zoneHeatTemp"]));
-        } else if (row["operations"]["state"]["zoneHVACmode"] == "cool") {
-            if (!row["operations"]["zoneCoolTemp"].empty())
-                dataWritten += influx.addMeasurement(prefix, "SetPoint", FtoC(row["operations"]["zoneCoolTemp"]));
-        }
-
-        /*
-         * Time specified operations
-         *
-         */
-
-        struct TimeOp {
-            std::string name{};
-            bool state{};
-            unsigned long seconds{};
-            unsigned long long timestamp{};
-            explicit TimeOp(std::string  name) :name(std::move(name)) {}
-        };
-
-        std::vector<TimeOp> timeOpList{};
-        timeOpList.emplace_back("Fan");
-        timeOpList.emplace_back("Heat");
-        timeOpList.emplace_back("Cool");
-
-        std::string HVACmode = row["operations"]["state"]["zoneHVACmode"];
-        if (HVACmode == "heatOff") {
-            for (auto& op : timeOpList)
-                op.state = false;
-        } else if (HVACmode == "heatStage1On") {
-            timeOpList[0].state = timeOpList[1].state = true;
-            timeOpList[2].state = false;
-        } else if (HVACmode == "compressorCoolStage10n") {
-            timeOpList[0].state = timeOpList[2].state = true;
-            timeOpList[1].state = false;
-        }
-
-        timeOpList[0].seconds = strtoul(std::string{row["operations"]["time"]["fan"]}.c_str(), nullptr, 10);
-        timeOpList[1].seconds = strtoul(std::string{row["operations"]["time"]["auxHeat1"]}.c_str(), nullptr, 10);
-        timeOpList[2].seconds = strtoul(std::string{row["operations"]["time"]["compCool1"]}.c_str(), nullptr, 10);
-
-        for (auto& op : timeOpList) {
-            op.timestamp = influx.getMeasurementEpoch();
-            op.state &= op.seconds != 0;
-            op.state |= op.seconds == 300;
-            if (op.seconds != 0 && op.seconds != 300) {
-                if (op.state)
-                    op.timestamp += op.seconds * 1000000000;
-                else
-                    op.timestamp -= (300 - op.seconds) * 1000000000;
-            }
-            dataWritten |= influx.addMeasurement(prefix, op.name, (op.state ? True : False), op.timestamp);
-        }
-
-        if (dataWritten)
-            influx.pushData();
-        dataWritten = false;
-    }
 } // ecoBee
\ No newline at end of file
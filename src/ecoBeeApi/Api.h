@@ -18,18 +18,24 @@
 #ifndef ECOBEEDATA_API_H
 #define ECOBEEDATA_API_H
 
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <string>
-#include <curlpp/cURLpp.hpp>
-#include <curlpp/Easy.hpp>
-#include <curlpp/Options.hpp>
-#include <curlpp/Exception.hpp>
-#include <curlpp/Infos.hpp>
 #include <nlohmann/json.hpp>
 #include <exception>
+#include <tuple>
 #include <utility>
 #include <ConfigFile.h>
-#include "InfluxPush.h"
+#include "InfluxBatch.h"
+#include "Rollup.h"
+#include "SeriesKeys.h"
 #include "StringComposite.h"
+#include "Tokens.h"
+
+class Spool;
+class AsyncWriter;
 
 namespace ecoBee {
     struct InfluxConfig {
@@ -38,8 +44,24 @@ namespace ecoBee {
         std::optional<std::string> influxHost{"influx"};
         std::optional<std::string> influxDb{"ecoBee"};
         std::optional<long> influxPort{8086};
+        InfluxBatch::Limits influxLimits{};
+        int influxGzipLevel{0};     ///< The gzip level of write requests, 0 to send them uncompressed.
+        Spool *spool{nullptr};      ///< If set points are written to the spool, which is replayed to the database.
+        AsyncWriter *writer{nullptr};   ///< If set batches are queued with the writer, which writes them.
+        bool rollups{false};        ///< True to write hourly and daily aggregates, see Rollup.
+        double rollupBaseTemperature{Rollup::DefaultBaseTemperature};
     };
 
+    /**
+     * @brief The transport batches are written with, the spool if the config has one, otherwise the database.
+     */
+    [[nodiscard]] InfluxBatch::Transport influxTransport(const InfluxConfig &config);
+
+    /**
+     * @brief A batch queuing with the config's writer if it has one, otherwise writing with influxTransport().
+     */
+    [[nodiscard]] std::unique_ptr<InfluxBatch> makeInfluxBatch(const InfluxConfig &config);
+
     std::string localToGMT(const std::string& date, const std::string& time);
 
     static constexpr std::string_view DateTimeFormat = "%Y-%m-%dT%H:%M:%SZ";
@@ -74,6 +96,21 @@ namespace ecoBee {
         { std::ranges::begin(range) } -> std::convertible_to<std::string_view*>;
     };
 
+    /**
+     * The base URL of the ecobee API.
+     */
+    static constexpr std::string_view EcoBeeApiUrl = "https://api.ecobee.com";
+
+    /**
+     * @brief Set the base URL requests are made to, for example a local stand-in. Set it before any request.
+     */
+    void setApiUrl(std::string_view url);
+
+    /**
+     * @brief The base URL requests are made to, EcoBeeApiUrl unless it was set.
+     */
+    [[nodiscard]] const std::string &apiUrl();
+
     static constexpr std::string_view Thermostat = "421866388280";
     static constexpr std::string_view ApiKey = "fpsld2HqnigU3P4vnsuP5zZ8pLlpsfup";
     static constexpr std::string_view AppPin = "LVMP-KJRP";
@@ -81,6 +118,22 @@ namespace ecoBee {
     struct AccessToken {
         std::string mAccessToken{}, mTokenType{}, mScope{}, mRefreshToke{};
         uint32_t mExpiresIn{};
+        std::chrono::system_clock::time_point mExpires{};   ///< When the access token expires.
+
+        AccessToken() = default;
+
+        /**
+         * @param token A token response, or the saved copy of one.
+         * @param received When the response was received, mExpiresIn is counted from here.
+         */
+        AccessToken(const nlohmann::json &token, std::chrono::system_clock::time_point received);
+
+        /**
+         * @brief True if the access token will have expired by a time.
+         */
+        [[nodiscard]] bool expiredBy(std::chrono::system_clock::time_point time) const {
+            return mAccessToken.empty() || time >= mExpires;
+        }
     };
 
     struct App {
@@ -89,7 +142,7 @@ namespace ecoBee {
     };
 
     static constexpr std::string_view OperationTimeParam = "auxHeat1,compCool1,fan";
-    static constexpr std::string_view OperationStateParam = "HVACmode,zoneHVACmode,zoneClimate";
+    static constexpr std::string_view OperationStateParam = "hvacMode,zoneHvacMode,zoneClimate";
     struct Sensor {
         enum Type { unknown, airPressure, temperature, occupancy, humidity };
         std::string id{}, name{}, usage{};
@@ -111,14 +164,29 @@ namespace ecoBee {
         std::string mApiKey, mApiPin, mAuthCode;
     };
 
+    /**
+     * The most thermostats the API accepts in one selection.
+     */
+    static constexpr std::size_t MaximumSelection = 25;
+
+    /**
+     * The longest span of time the API returns in one runtime report.
+     */
+    static constexpr std::chrono::days MaximumReportSpan{31};
+
+    /**
+     * @param columns The report columns.
+     * @param includeSensors True to include the sensor data.
+     * @param selectionMatch The identifiers of the thermostats, comma separated, at most MaximumSelection.
+     */
     template<class Columns>
     requires StringRange<Columns>
 
-    std::string runtimeReportUrl(const Columns columns, bool includeSensors,
+    std::string runtimeReportUrl(const Columns columns, bool includeSensors, std::string_view selectionMatch,
                  const std::string& startD, const std::string& startI, const std::string& endD, const std::string& endI) {
         std::stringstream url{};
 
-        url << R"(https://api.ecobee.com/1/runtimeReport?format=json&body={"startDate":")" << startD
+        url << apiUrl() << R"(/1/runtimeReport?format=json&body={"startDate":")" << startD
             << R"(","startInterval":")" << startI
             << R"(","endDate":")" << endD
             << R"(","endInterval":")" << endI
@@ -131,16 +199,60 @@ namespace ecoBee {
         }
 
         url << R"(","includeSensors":)" << (includeSensors ? "true" : "false") << ',';
-        url << R"("selection":{"selectionType":"thermostats","selectionMatch":")" << Thermostat << R"("}})";
+        url << R"("selection":{"selectionType":"thermostats","selectionMatch":")" << selectionMatch << R"("}})";
         return url.str();
     }
 
-    std::string escapeHeader(const std::string& hdr);
+    /**
+     * @brief Parse a report field as a number, std::nullopt if it is empty or not a number.
+     */
+    [[nodiscard]] inline std::optional<double> parseNumber(std::string_view field) {
+        double value{};
+        if (auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+                result.ec != std::errc{} || result.ptr != field.data() + field.size())
+            return std::nullopt;
+        return value;
+    }
+
+    /**
+     * @brief Convert a Fahrenheit temperature to Celsius.
+     */
+    [[nodiscard]] constexpr double FtoC(double f) {
+        return (f - 32.) * 5. / 9.;
+    }
+
+    /**
+     * @brief Convert a Pascals pressure to hecto Pascals.
+     */
+    [[nodiscard]] constexpr double hectoPascals(double p) {
+        return p / 100.;
+    }
 
     [[nodiscard]] ApiStatus statusPoll(nlohmann::json &poll, const std::string &token);
 
+    class RuntimeReportReader;
+
+    /**
+     * @brief Request a runtime report and parse it while it downloads.
+     * @details Rows are written by the reader as they arrive, call RuntimeReportReader::finish() to write the
+     * rest once the status is OK.
+     * @param reader The reader the report is parsed by.
+     * @param token The access token.
+     * @param url The report URL.
+     * @throws HtmlError if the HTML response code is not 200 and not 500, HttpError if the transfer failed.
+     * @return ApiStatus::OK, or ApiStatus::TokenExpired if the access token is expired.
+     */
     [[nodiscard]] ApiStatus
-    runtimeReport(nlohmann::json &data, const std::string &token, const std::string &url);
+    runtimeReport(RuntimeReportReader &reader, const std::string &token, const std::string &url);
+
+    /**
+     * @brief Request a runtime report into memory, to be parsed by a RuntimeReportReader later.
+     * @param report The RETURNED report.
+     * @param token The access token.
+     * @param url The report URL.
+     * @throws HtmlError if the HTML response code is not 200 and not 500, HttpError if the transfer failed.
+     */
+    void fetchRuntimeReport(std::string &report, const std::string &token, const std::string &url);
 
     [[nodiscard]] ApiStatus refreshAccessToken(nlohmann::json& accessToken, const std::string& url, const std::string& apiKey,
                                  const std::string& token);
@@ -149,10 +261,22 @@ namespace ecoBee {
 
     [[nodiscard]] std::tuple<std::string,std::string,std::string,std::string,std::string> runtimeIntervals(const std::string& lastTime);
 
+    /**
+     * @brief The runtime report dates and intervals of the span of time [start, end).
+     * @return A tuple with the start date, interval and end date, interval of the last interval in the span.
+     */
+    [[nodiscard]] std::tuple<std::string,std::string,std::string,std::string>
+    runtimeIntervals(std::chrono::sys_seconds start, std::chrono::sys_seconds end);
+
     [[nodiscard]] std::string
     processRuntimeData(const nlohmann::json &data, const InfluxConfig &influxConfig, std::string &lastData);
 
-    void influxPush(nlohmann::json &row, InfluxPush &influx, const std::string &date, const std::string &time);
+    /**
+     * @brief Process the results of a Runtime Report into a caller supplied batch.
+     * @details The batch is flushed before returning.
+     */
+    [[nodiscard]] std::string
+    processRuntimeData(const nlohmann::json &data, InfluxBatch &influx, std::string &lastData);
 } // ecoBee
 
 #endif //ECOBEEDATA_API_H
@@ -0,0 +1,104 @@
+/**
+ * @file Coverage.cpp
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include "Coverage.h"
+#include "AtomicFile.h"
+#include "Api.h"
+
+namespace ecoBee {
+    Coverage::Coverage(std::filesystem::path path) : mPath(std::move(path)) {
+        std::ifstream strm(mPath);
+        if (!strm)
+            return;
+
+        std::string line;
+        while (std::getline(strm, line)) {
+            std::istringstream fields{line};
+            std::string id{}, start{}, end{};
+            if (!(fields >> id >> start >> end))
+                throw CoverageError("Coverage " + mPath.string() + " is not valid: " + line);
+            auto startTime = parseTime(start);
+            auto endTime = parseTime(end);
+            if (!startTime || !endTime || startTime.value() >= endTime.value())
+                throw CoverageError("Coverage " + mPath.string() + " is not valid: " + line);
+            mSpans[id].push_back(Span{startTime.value(), endTime.value()});
+        }
+
+        for (auto &[id, spans] : mSpans)
+            std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) { return a.start < b.start; });
+    }
+
+    std::vector<Coverage::Span> Coverage::gaps(const std::string &id, Time from, Time to) const {
+        std::vector<Span> gaps{};
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (auto itr = mSpans.find(id); itr != mSpans.end()) {
+            for (const auto &span : itr->second) {
+                if (span.end <= from)
+                    continue;
+                if (span.start >= to)
+                    break;
+                if (span.start > from)
+                    gaps.push_back(Span{from, span.start});
+                from = span.end;
+            }
+        }
+        if (from < to)
+            gaps.push_back(Span{from, to});
+        return gaps;
+    }
+
+    void Coverage::add(const std::string &id, Span span) {
+        if (span.start >= span.end)
+            return;
+
+        std::lock_guard<std::mutex> lock{mMutex};
+        auto &spans = mSpans[id];
+
+        // Spans overlapping or touching the new one are merged into it.
+        auto first = std::find_if(spans.begin(), spans.end(), [&span](const Span &s) { return s.end >= span.start; });
+        auto last = std::find_if(first, spans.end(), [&span](const Span &s) { return s.start > span.end; });
+        if (first != last) {
+            span.start = std::min(span.start, first->start);
+            span.end = std::max(span.end, std::prev(last)->end);
+        }
+        spans.insert(spans.erase(first, last), span);
+        saveLocked();
+    }
+
+    void Coverage::saveLocked() const {
+        std::ostringstream text{};
+        for (const auto &[id, spans] : mSpans) {
+            for (const auto &span : spans)
+                text << id << ' ' << formatTime(span.start) << ' ' << formatTime(span.end) << '\n';
+        }
+
+        try {
+            replaceFile(mPath, text.str());
+        } catch (const AtomicFileError &e) {
+            throw CoverageError(std::string{"Coverage "} + e.what());
+        }
+    }
+
+    std::optional<Coverage::Time> Coverage::parseTime(std::string_view gmt) {
+        std::tm dateTime{};
+        std::string text{gmt};
+        auto end = strptime(text.c_str(), std::string{DateTimeFormat}.c_str(), &dateTime);
+        if (!end || *end != '\0')
+            return std::nullopt;
+        return Time{std::chrono::seconds{::timegm(&dateTime)}};
+    }
+
+    std::string Coverage::formatTime(Time time) {
+        auto epoch = static_cast<time_t>(time.time_since_epoch().count());
+        std::tm dateTime{};
+        char buf[32];
+        strftime(buf, sizeof(buf), std::string{DateTimeFormat}.c_str(), gmtime_r(&epoch, &dateTime));
+        return std::string{buf};
+    }
+
+} // ecoBee
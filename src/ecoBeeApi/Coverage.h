@@ -0,0 +1,89 @@
+/**
+ * @file Coverage.h
+ * @brief A record of the spans of time whose runtime data has been written to the database.
+ * @details Each thermostat has a list of spans, from the start of the report that wrote them to the end of the
+ * interval of the last row written. Time not in a span is a gap that a backfill requests again, whether it is
+ * before, between or after the spans.
+ */
+
+#ifndef ECOBEEDATA_COVERAGE_H
+#define ECOBEEDATA_COVERAGE_H
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ecoBee {
+
+    class CoverageError : public std::runtime_error {
+    public:
+        explicit CoverageError(const std::string &what_arg) : std::runtime_error(what_arg) {}
+    };
+
+    /**
+     * @class Coverage
+     * @details The record is a text file with one line per span, "id start end" with GMT times. It is replaced
+     * atomically on each change so it is never left partly written. All members may be called from more than
+     * one thread.
+     */
+    class Coverage {
+    public:
+        using Time = std::chrono::sys_seconds;
+
+        /**
+         * The span of time [start, end).
+         */
+        struct Span {
+            Time start{};
+            Time end{};
+        };
+
+    private:
+        std::filesystem::path mPath;
+        std::map<std::string, std::vector<Span>> mSpans{};     ///< Sorted, disjoint spans by thermostat id.
+        mutable std::mutex mMutex{};
+
+        void saveLocked() const;
+
+    public:
+        Coverage() = delete;
+
+        /**
+         * @brief Read the record, a missing record is empty.
+         * @throws CoverageError if the record can not be read.
+         */
+        explicit Coverage(std::filesystem::path path);
+
+        /**
+         * @brief The spans of a thermostat between two times that have not been written.
+         * @return The gaps in time order.
+         */
+        [[nodiscard]] std::vector<Span> gaps(const std::string &id, Time from, Time to) const;
+
+        /**
+         * @brief Record a span as written and save the record.
+         * @details The span is merged with the spans it overlaps or touches.
+         * @throws CoverageError if the record can not be written.
+         */
+        void add(const std::string &id, Span span);
+
+        /**
+         * @brief Parse a GMT time in the DateTimeFormat.
+         */
+        static std::optional<Time> parseTime(std::string_view gmt);
+
+        /**
+         * @brief Format a time as GMT in the DateTimeFormat.
+         */
+        static std::string formatTime(Time time);
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_COVERAGE_H
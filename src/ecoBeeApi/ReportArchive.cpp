@@ -0,0 +1,590 @@
+/**
+ * @file ReportArchive.cpp
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+#include <unordered_map>
+#include <zlib.h>
+#include "ReportArchive.h"
+#include "RuntimePlan.h"
+#include "Tokens.h"
+
+namespace ecoBee {
+
+    namespace {
+        constexpr std::string_view Magic = "EBRA";
+        constexpr std::uint16_t Version = 1;
+
+        /**
+         * Magic, version, id bytes, body bytes, raw bytes, rows, first, last then the CRC of the header fields
+         * before it, the id and the body.
+         */
+        constexpr std::size_t HeaderBytes = 40;
+        constexpr std::size_t CrcOffset = 36;
+
+        constexpr int MaximumScale = 9;
+        constexpr std::size_t MaximumDigits = 18;
+
+        constexpr std::array<std::string_view, 5> SensorTypes{"unknown", "airPressure", "temperature", "occupancy",
+                                                               "humidity"};
+
+        enum class ColumnKind : std::uint8_t {
+            Number,         ///< Scaled integers, each the change from the last value present.
+            Dictionary,     ///< The distinct values, then the index of each row's value.
+        };
+
+        template<typename Integer>
+        void putInteger(std::string &out, Integer value) {
+            auto bits = static_cast<std::make_unsigned_t<Integer>>(value);
+            for (std::size_t idx = 0; idx < sizeof(Integer); ++idx)
+                out.push_back(static_cast<char>((bits >> (8 * idx)) & 0xffu));
+        }
+
+        template<typename Integer>
+        Integer getInteger(std::string_view data, std::size_t offset) {
+            std::make_unsigned_t<Integer> bits{0};
+            for (std::size_t idx = 0; idx < sizeof(Integer); ++idx)
+                bits |= static_cast<std::make_unsigned_t<Integer>>(
+                        static_cast<std::make_unsigned_t<Integer>>(static_cast<unsigned char>(data[offset + idx]))
+                                << (8 * idx));
+            return static_cast<Integer>(bits);
+        }
+
+        void putVarint(std::string &out, std::uint64_t value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>((value & 0x7fu) | 0x80u));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        void putString(std::string &out, std::string_view text) {
+            putVarint(out, text.size());
+            out.append(text);
+        }
+
+        std::uint64_t zigzag(std::int64_t value) {
+            return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+
+        std::int64_t unzigzag(std::uint64_t value) {
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1u);
+        }
+
+        std::uint32_t blockCrc(std::string_view header, std::string_view rest) {
+            auto crc = crc32(0L, reinterpret_cast<const Bytef *>(header.data() + Magic.size()),
+                             static_cast<uInt>(CrcOffset - Magic.size()));
+            crc = crc32(crc, reinterpret_cast<const Bytef *>(rest.data()), static_cast<uInt>(rest.size()));
+            return static_cast<std::uint32_t>(crc);
+        }
+
+        /**
+         * Read the values of a block body in order.
+         */
+        class Decoder {
+            std::string_view mData;
+
+            void need(std::uint64_t size) const {
+                if (size > mData.size())
+                    throw ArchiveError("Archive block ends part way through a value.");
+            }
+
+        public:
+            explicit Decoder(std::string_view data) : mData(data) {}
+
+            std::uint64_t varint() {
+                std::uint64_t value{0};
+                for (unsigned shift = 0; shift < 64; shift += 7) {
+                    need(1);
+                    auto byte = static_cast<unsigned char>(mData.front());
+                    mData.remove_prefix(1);
+                    value |= static_cast<std::uint64_t>(byte & 0x7fu) << shift;
+                    if ((byte & 0x80u) == 0)
+                        return value;
+                }
+                throw ArchiveError("Archive block value is too long.");
+            }
+
+            std::string_view bytes(std::uint64_t size) {
+                need(size);
+                auto text = mData.substr(0, static_cast<std::size_t>(size));
+                mData.remove_prefix(static_cast<std::size_t>(size));
+                return text;
+            }
+
+            std::string_view string() {
+                return bytes(varint());
+            }
+
+            std::uint8_t byte() {
+                return static_cast<std::uint8_t>(bytes(1).front());
+            }
+
+            /**
+             * @brief A count of items each taking at least one byte, checked against what is left.
+             */
+            std::size_t count() {
+                auto value = varint();
+                need(value);
+                return static_cast<std::size_t>(value);
+            }
+        };
+
+        /**
+         * @brief Read a decimal number, "-12.34" is -1234 with a scale of 2.
+         */
+        bool parseDecimal(std::string_view text, std::int64_t &value, int &scale) {
+            auto point = text.find('.');
+            auto integer = text.substr(0, point);
+            auto fraction = point == std::string_view::npos ? std::string_view{} : text.substr(point + 1);
+            if (point != std::string_view::npos && fraction.empty())
+                return false;
+            bool negative = integer.starts_with('-');
+            if (negative)
+                integer.remove_prefix(1);
+            if (integer.empty() || fraction.size() > MaximumScale || integer.size() + fraction.size() > MaximumDigits)
+                return false;
+
+            std::uint64_t digits{0};
+            for (auto part : {integer, fraction}) {
+                for (auto c : part) {
+                    if (c < '0' || c > '9')
+                        return false;
+                    digits = digits * 10 + static_cast<std::uint64_t>(c - '0');
+                }
+            }
+            value = negative ? -static_cast<std::int64_t>(digits) : static_cast<std::int64_t>(digits);
+            scale = static_cast<int>(fraction.size());
+            return true;
+        }
+
+        void formatDecimal(std::int64_t value, int scale, std::string &out) {
+            std::array<char, 32> buffer{};
+            auto magnitude = value < 0 ? 0 - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+            auto width = static_cast<std::ptrdiff_t>(scale) + 1;
+
+            // The digits leave room to zero pad on the left so there is a digit before the point.
+            auto digits = buffer.data() + width;
+            auto end = std::to_chars(digits, buffer.data() + buffer.size(), magnitude).ptr;
+            auto begin = std::min(digits, end - width);
+            std::fill(begin, digits, '0');
+            std::string_view padded{begin, static_cast<std::size_t>(end - begin)};
+
+            if (value < 0)
+                out.push_back('-');
+            out.append(padded.substr(0, padded.size() - static_cast<std::size_t>(scale)));
+            if (scale > 0)
+                out.append(".").append(padded.substr(padded.size() - static_cast<std::size_t>(scale)));
+        }
+
+        /**
+         * @brief Encode the values of one column, as numbers if every value reads back as it was written.
+         */
+        void encodeColumn(std::string &out, const std::vector<std::string_view> &values) {
+            std::vector<std::int64_t> numbers(values.size());
+            int scale{-1};
+            bool numeric{true};
+            std::string text{};
+            for (std::size_t row = 0; numeric && row < values.size(); ++row) {
+                if (values[row].empty())
+                    continue;
+                int valueScale{};
+                numeric = parseDecimal(values[row], numbers[row], valueScale) && (scale < 0 || valueScale == scale);
+                if (numeric) {
+                    scale = valueScale;
+                    text.clear();
+                    formatDecimal(numbers[row], scale, text);
+                    numeric = text == values[row];
+                }
+            }
+
+            if (numeric) {
+                out.push_back(static_cast<char>(ColumnKind::Number));
+                out.push_back(static_cast<char>(std::max(scale, 0)));
+                std::int64_t previous{0};
+                for (std::size_t row = 0; row < values.size(); ++row) {
+                    if (values[row].empty()) {
+                        putVarint(out, 0);
+                    } else {
+                        putVarint(out, zigzag(numbers[row] - previous) + 1);
+                        previous = numbers[row];
+                    }
+                }
+                return;
+            }
+
+            std::unordered_map<std::string_view, std::uint64_t> index{};
+            std::vector<std::string_view> dictionary{};
+            std::vector<std::uint64_t> rows{};
+            rows.reserve(values.size());
+            for (auto value : values) {
+                auto [entry, added] = index.try_emplace(value, dictionary.size());
+                if (added)
+                    dictionary.push_back(value);
+                rows.push_back(entry->second);
+            }
+            out.push_back(static_cast<char>(ColumnKind::Dictionary));
+            putVarint(out, dictionary.size());
+            for (auto value : dictionary)
+                putString(out, value);
+            for (auto row : rows)
+                putVarint(out, row);
+        }
+
+        /**
+         * The values of one decoded column.
+         */
+        struct Column {
+            std::string text{};
+            std::vector<std::size_t> ends{};
+
+            std::string_view operator[](std::size_t row) const {
+                auto begin = row ? ends[row - 1] : 0;
+                return std::string_view{text}.substr(begin, ends[row] - begin);
+            }
+        };
+
+        Column decodeColumn(Decoder &decoder, std::size_t rows) {
+            Column column{};
+            column.ends.reserve(rows);
+            switch (static_cast<ColumnKind>(decoder.byte())) {
+                case ColumnKind::Number: {
+                    auto scale = static_cast<int>(decoder.byte());
+                    if (scale > MaximumScale)
+                        throw ArchiveError("Archive column scale is not valid.");
+                    std::int64_t previous{0};
+                    for (std::size_t row = 0; row < rows; ++row) {
+                        if (auto change = decoder.varint(); change) {
+                            previous += unzigzag(change - 1);
+                            formatDecimal(previous, scale, column.text);
+                        }
+                        column.ends.push_back(column.text.size());
+                    }
+                    break;
+                }
+                case ColumnKind::Dictionary: {
+                    std::vector<std::string_view> dictionary(decoder.count());
+                    for (auto &value : dictionary)
+                        value = decoder.string();
+                    for (std::size_t row = 0; row < rows; ++row) {
+                        auto entry = decoder.varint();
+                        if (entry >= dictionary.size())
+                            throw ArchiveError("Archive column index is not valid.");
+                        column.text.append(dictionary[static_cast<std::size_t>(entry)]);
+                        column.ends.push_back(column.text.size());
+                    }
+                    break;
+                }
+                default:
+                    throw ArchiveError("Archive column kind is not valid.");
+            }
+            return column;
+        }
+
+        std::size_t tokenCount(std::string_view text) {
+            return static_cast<std::size_t>(std::ranges::distance(Tokens{text, ','}));
+        }
+
+        void splitRow(std::string_view row, std::vector<std::string_view> &fields) {
+            fields.clear();
+            for (auto field : Tokens{row, ','})
+                fields.push_back(field);
+        }
+
+        /**
+         * @brief Walk the complete blocks of an archive.
+         * @param blocks If not nullptr the block headers are appended.
+         * @return The size of the complete blocks, anything after is a block cut short.
+         */
+        std::size_t scanBlocks(std::string_view data, std::vector<ArchiveReader::Block> *blocks) {
+            std::size_t offset{0};
+            while (data.size() - offset >= HeaderBytes) {
+                auto header = data.substr(offset, HeaderBytes);
+                if (!header.starts_with(Magic) || getInteger<std::uint16_t>(header, 4) != Version)
+                    break;
+                auto idBytes = getInteger<std::uint16_t>(header, 6);
+                auto bodyBytes = getInteger<std::uint32_t>(header, 8);
+                auto size = HeaderBytes + idBytes + bodyBytes;
+                if (size > data.size() - offset)
+                    break;
+                auto rest = data.substr(offset + HeaderBytes, size - HeaderBytes);
+                if (blockCrc(header, rest) != getInteger<std::uint32_t>(header, CrcOffset))
+                    break;
+
+                if (blocks)
+                    blocks->push_back(ArchiveReader::Block{rest.substr(0, idBytes),
+                                                           getInteger<std::int64_t>(header, 20),
+                                                           getInteger<std::int64_t>(header, 28),
+                                                           getInteger<std::uint32_t>(header, 16),
+                                                           getInteger<std::uint32_t>(header, 12),
+                                                           rest.substr(idBytes)});
+                offset += size;
+            }
+            return offset;
+        }
+
+        /**
+         * @brief Format local seconds as a report date, YYYY-MM-DD, and time, HH:MM:SS.
+         */
+        void formatLocal(LocalSeconds seconds, std::array<char, 32> &date, std::array<char, 32> &time) {
+            using namespace std::chrono;
+            sys_seconds point{std::chrono::seconds{seconds}};
+            auto days = floor<std::chrono::days>(point);
+            year_month_day ymd{days};
+            hh_mm_ss clock{point - days};
+            std::snprintf(date.data(), date.size(), "%04d-%02u-%02u", static_cast<int>(ymd.year()),
+                          static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()));
+            std::snprintf(time.data(), time.size(), "%02ld:%02ld:%02ld", static_cast<long>(clock.hours().count()),
+                          static_cast<long>(clock.minutes().count()), static_cast<long>(clock.seconds().count()));
+        }
+    }
+
+    std::optional<LocalSeconds> localSeconds(std::string_view date, std::string_view time) {
+        auto number = [](std::string_view text, std::size_t pos, std::size_t length) -> std::optional<int> {
+            int value{};
+            auto begin = text.data() + pos, end = begin + length;
+            if (auto result = std::from_chars(begin, end, value);
+                    result.ec != std::errc{} || result.ptr != end || value < 0)
+                return std::nullopt;
+            return value;
+        };
+
+        if (date.size() != 10 || date[4] != '-' || date[7] != '-' ||
+            time.size() != 8 || time[2] != ':' || time[5] != ':')
+            return std::nullopt;
+        auto year = number(date, 0, 4), month = number(date, 5, 2), day = number(date, 8, 2);
+        auto hours = number(time, 0, 2), minutes = number(time, 3, 2), seconds = number(time, 6, 2);
+        if (!year || !month || !day || !hours || !minutes || !seconds ||
+            hours.value() > 23 || minutes.value() > 59 || seconds.value() > 59)
+            return std::nullopt;
+
+        std::chrono::year_month_day ymd{std::chrono::year{year.value()},
+                                        std::chrono::month{static_cast<unsigned>(month.value())},
+                                        std::chrono::day{static_cast<unsigned>(day.value())}};
+        if (!ymd.ok())
+            return std::nullopt;
+        return static_cast<LocalSeconds>(std::chrono::sys_days{ymd}.time_since_epoch().count()) * 86400 +
+               hours.value() * 3600 + minutes.value() * 60 + seconds.value();
+    }
+
+    void ReportWindow::describe(const std::string &columns, const std::vector<Sensor> &sensors,
+                                const std::vector<std::string> &sensorColumns) {
+        mColumns = columns;
+        mSensors = sensors;
+        mSensorColumns = sensorColumns;
+    }
+
+    void ReportWindow::add(std::string_view reportRow, std::string_view sensorRow) {
+        if (tokenCount(reportRow) != tokenCount(mColumns) + 2)
+            return;
+        mReportRows.emplace_back(reportRow);
+        mSensorRows.emplace_back(sensorRow);
+    }
+
+    std::string ReportWindow::encode(int level) const {
+        std::string body{};
+        putString(body, mColumns);
+        putVarint(body, mSensors.size());
+        for (const auto &sensor : mSensors) {
+            putString(body, sensor.id);
+            putString(body, sensor.name);
+            putString(body, sensor.usage);
+            body.push_back(static_cast<char>(sensor.type));
+        }
+        putVarint(body, mSensorColumns.size());
+        for (const auto &column : mSensorColumns)
+            putString(body, column);
+
+        // The row fields by column, the date and time become local seconds. Sensor rows without a field for
+        // every sensor column are marked not valid, the report row values are used in their place.
+        auto columnCount = tokenCount(mColumns) + 2;
+        auto sensorCount = std::max<std::size_t>(mSensorColumns.size(), 2);
+        std::vector<std::vector<std::string_view>> report(columnCount - 2), sensors(sensorCount - 2);
+        std::vector<LocalSeconds> times{};
+        std::string valid{};
+        std::vector<std::string_view> fields{};
+        for (std::size_t row = 0; row < mReportRows.size(); ++row) {
+            splitRow(mReportRows[row], fields);
+            auto time = fields.size() == columnCount ? localSeconds(fields[0], fields[1]) : std::nullopt;
+            if (!time)
+                continue;
+            times.push_back(time.value());
+            for (std::size_t column = 2; column < columnCount; ++column)
+                report[column - 2].push_back(fields[column]);
+
+            splitRow(mSensorRows[row], fields);
+            auto sensorValid = fields.size() == mSensorColumns.size();
+            valid.push_back(sensorValid ? '\1' : '\0');
+            for (std::size_t column = 2; column < sensorCount; ++column)
+                sensors[column - 2].push_back(sensorValid ? fields[column] : std::string_view{});
+        }
+
+        putVarint(body, times.size());
+        LocalSeconds previous{0};
+        for (auto time : times) {
+            putVarint(body, zigzag(time - previous));
+            previous = time;
+        }
+        for (const auto &column : report)
+            encodeColumn(body, column);
+        body.append(valid);
+        for (const auto &column : sensors)
+            encodeColumn(body, column);
+
+        auto compressedBytes = compressBound(static_cast<uLong>(body.size()));
+        std::string compressed(compressedBytes, '\0');
+        if (body.size() > std::numeric_limits<std::uint32_t>::max() || mId.size() > std::numeric_limits<std::uint16_t>::max() ||
+            compress2(reinterpret_cast<Bytef *>(compressed.data()), &compressedBytes,
+                      reinterpret_cast<const Bytef *>(body.data()), static_cast<uLong>(body.size()), level) != Z_OK)
+            throw ArchiveError("Archive window of " + mId + " can not be compressed.");
+        compressed.resize(compressedBytes);
+
+        auto [first, last] = std::ranges::minmax(times.empty() ? std::vector<LocalSeconds>{0} : times);
+        std::string block{Magic};
+        putInteger(block, Version);
+        putInteger(block, static_cast<std::uint16_t>(mId.size()));
+        putInteger(block, static_cast<std::uint32_t>(compressed.size()));
+        putInteger(block, static_cast<std::uint32_t>(body.size()));
+        putInteger(block, static_cast<std::uint32_t>(times.size()));
+        putInteger(block, static_cast<std::int64_t>(first));
+        putInteger(block, static_cast<std::int64_t>(last));
+        auto rest = mId + compressed;
+        putInteger(block, blockCrc(block, rest));
+        block.append(rest);
+        return block;
+    }
+
+    ReportArchive::ReportArchive(std::filesystem::path path) : mPath(std::move(path)) {
+        mFile = ::open(mPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (mFile < 0)
+            throw ArchiveError("Archive " + mPath.string() + ": " + strerror(errno));
+
+        // New blocks never follow one cut short, it would hide them from every reader.
+        MappedFile mapped{};
+        if (mapped.map(mPath)) {
+            mSize = scanBlocks(mapped.view(), nullptr);
+            if (mSize == mapped.view().size() || ::ftruncate(mFile, static_cast<off_t>(mSize)) == 0)
+                return;
+        }
+        std::string error{strerror(errno)};
+        ::close(mFile);
+        throw ArchiveError("Archive " + mPath.string() + ": " + error);
+    }
+
+    ReportArchive::~ReportArchive() {
+        ::close(mFile);
+    }
+
+    void ReportArchive::append(const ReportWindow &window) {
+        if (window.empty())
+            return;
+
+        auto block = window.encode();
+        auto fail = [this](const char *action) {
+            std::string error{strerror(errno)};
+            if (::ftruncate(mFile, static_cast<off_t>(mSize)) < 0)
+                error.append(", the archive ends with a block cut short");
+            throw ArchiveError(std::string{"Archive "} + action + mPath.string() + ": " + error);
+        };
+        for (std::string_view data{block}; !data.empty();) {
+            auto count = ::write(mFile, data.data(), data.size());
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                fail("write ");
+            }
+            data.remove_prefix(static_cast<std::size_t>(count));
+        }
+        if (::fdatasync(mFile) < 0)
+            fail("sync ");
+        mSize += block.size();
+    }
+
+    ArchiveReader::ArchiveReader(const std::filesystem::path &path) {
+        if (!mFile.map(path))
+            throw ArchiveError("Archive " + path.string() + ": " + strerror(errno));
+        scanBlocks(mFile.view(), &mBlocks);
+    }
+
+    bool ArchiveReader::isArchive(const std::filesystem::path &path) {
+        std::ifstream strm{path, std::ios::binary};
+        std::array<char, Magic.size()> magic{};
+        return strm.read(magic.data(), magic.size()) && std::string_view{magic.data(), magic.size()} == Magic;
+    }
+
+    std::size_t ArchiveReader::replay(std::string_view id, SeriesKeys &seriesKeys, InfluxBatch &influx,
+                                      LocalSeconds from) const {
+        std::size_t written{0};
+        std::string body{};
+        std::vector<std::string_view> report{}, sensors{};
+        std::array<char, 32> date{}, time{};
+
+        for (const auto &block : mBlocks) {
+            if (block.id != id || block.last < from)
+                continue;
+
+            body.resize(block.rawBytes);
+            uLongf size = block.rawBytes;
+            if (uncompress(reinterpret_cast<Bytef *>(body.data()), &size,
+                           reinterpret_cast<const Bytef *>(block.body.data()),
+                           static_cast<uLong>(block.body.size())) != Z_OK || size != block.rawBytes)
+                throw ArchiveError("Archive block of " + std::string{id} + " can not be inflated.");
+
+            Decoder decoder{body};
+            auto columns = decoder.string();
+            std::vector<Sensor> sensorList{};
+            for (auto count = decoder.count(); sensorList.size() < count;) {
+                auto sensorId = decoder.string(), name = decoder.string(), usage = decoder.string();
+                auto type = std::min<std::size_t>(decoder.byte(), SensorTypes.size() - 1);
+                sensorList.emplace_back(std::string{sensorId}, std::string{name}, std::string{SensorTypes[type]},
+                                        std::string{usage});
+            }
+            std::vector<std::string> sensorColumns(decoder.count());
+            for (auto &column : sensorColumns)
+                column = decoder.string();
+
+            auto rows = decoder.count();
+            std::vector<LocalSeconds> times(rows);
+            LocalSeconds previous{0};
+            for (auto &rowTime : times)
+                rowTime = previous += unzigzag(decoder.varint());
+
+            std::vector<Column> reportColumns(tokenCount(columns));
+            for (auto &column : reportColumns)
+                column = decodeColumn(decoder, rows);
+            auto valid = decoder.bytes(rows);
+            std::vector<Column> sensorColumnData(std::max<std::size_t>(sensorColumns.size(), 2) - 2);
+            for (auto &column : sensorColumnData)
+                column = decodeColumn(decoder, rows);
+
+            RuntimePlan plan{columns, sensorList, sensorColumns, seriesKeys};
+            for (std::size_t row = 0; row < rows; ++row) {
+                if (times[row] < from)
+                    continue;
+                formatLocal(times[row], date, time);
+                report.assign({std::string_view{date.data()}, std::string_view{time.data()}});
+                for (const auto &column : reportColumns)
+                    report.push_back(column[row]);
+                sensors.clear();
+                if (valid[row]) {
+                    sensors.assign({std::string_view{date.data()}, std::string_view{time.data()}});
+                    for (const auto &column : sensorColumnData)
+                        sensors.push_back(column[row]);
+                }
+                plan.write(influx, report, sensors);
+                ++written;
+            }
+        }
+        return written;
+    }
+
+} // ecoBee
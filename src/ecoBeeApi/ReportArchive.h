@@ -0,0 +1,180 @@
+/**
+ * @file ReportArchive.h
+ * @brief An append only archive of the runtime report rows written, compact enough to keep and fast to replay.
+ * @details Each report window of each thermostat is one block. The block header holds the thermostat and the
+ * time span of its rows, so the headers index the archive and blocks outside a replay are skipped without being
+ * read. The body is zlib compressed typed columns:
+ *  - The row date and time as the change in seconds from the row before.
+ *  - Numeric columns as the change in their value scaled to an integer, each value is written back as it was.
+ *  - Other columns as a dictionary of their values and an index per row.
+ * Blocks are synced to disk as they are appended. A block cut short by a crash ends the archive, it is
+ * truncated when the archive is next opened for appending.
+ */
+
+#ifndef ECOBEEDATA_REPORTARCHIVE_H
+#define ECOBEEDATA_REPORTARCHIVE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Api.h"
+#include "InfluxBatch.h"
+#include "MappedFile.h"
+#include "SeriesKeys.h"
+
+namespace ecoBee {
+
+    class ArchiveError : public std::runtime_error {
+    public:
+        explicit ArchiveError(const std::string &what_arg) : std::runtime_error(what_arg) {}
+    };
+
+    /**
+     * Seconds since the Unix epoch of a thermostat's local date and time, read as if it were UTC.
+     */
+    using LocalSeconds = long long;
+
+    /**
+     * @brief The local seconds of a report date and time.
+     * @param date The date as YYYY-MM-DD.
+     * @param time The time as HH:MM:SS.
+     * @return The seconds, std::nullopt if the date or time is not valid.
+     */
+    std::optional<LocalSeconds> localSeconds(std::string_view date, std::string_view time);
+
+    /**
+     * @class ReportWindow
+     * @brief The rows of one thermostat from one runtime report, gathered as they are written.
+     */
+    class ReportWindow {
+        std::string mId;
+        std::string mColumns{};
+        std::vector<Sensor> mSensors{};
+        std::vector<std::string> mSensorColumns{};
+        std::vector<std::string> mReportRows{}, mSensorRows{};
+
+    public:
+        static constexpr int DefaultLevel = 6;     ///< The zlib compression level.
+
+        ReportWindow() = delete;
+
+        /**
+         * @param id The thermostat identifier.
+         */
+        explicit ReportWindow(std::string id) : mId(std::move(id)) {}
+
+        /**
+         * @brief Set the report columns and sensors the rows follow.
+         */
+        void describe(const std::string &columns, const std::vector<Sensor> &sensors,
+                      const std::vector<std::string> &sensorColumns);
+
+        /**
+         * @brief Add a row written to the database, rows without a field for every column are not kept.
+         */
+        void add(std::string_view reportRow, std::string_view sensorRow);
+
+        [[nodiscard]] bool empty() const {
+            return mReportRows.empty();
+        }
+
+        [[nodiscard]] const std::string &id() const {
+            return mId;
+        }
+
+        /**
+         * @brief The window as an archive block.
+         * @param level The zlib compression level.
+         * @throws ArchiveError if the rows can not be compressed.
+         */
+        [[nodiscard]] std::string encode(int level = DefaultLevel) const;
+    };
+
+    /**
+     * @class ReportArchive
+     * @brief Append report windows to an archive file.
+     */
+    class ReportArchive {
+        std::filesystem::path mPath;
+        int mFile{-1};
+        std::size_t mSize{0};          ///< The size of the complete blocks in the file.
+
+    public:
+        ReportArchive() = delete;
+        ReportArchive(const ReportArchive &) = delete;
+        ReportArchive &operator=(const ReportArchive &) = delete;
+
+        /**
+         * @param path The archive file, it is created if it does not exist.
+         * @throws ArchiveError if the file can not be opened or a cut short block can not be removed.
+         */
+        explicit ReportArchive(std::filesystem::path path);
+
+        ~ReportArchive();
+
+        /**
+         * @brief Append a window and sync it to disk, an empty window is not appended.
+         * @throws ArchiveError if the window can not be written, the archive is left as it was.
+         */
+        void append(const ReportWindow &window);
+    };
+
+    /**
+     * @class ArchiveReader
+     * @brief Replay the rows of a memory mapped archive.
+     */
+    class ArchiveReader {
+    public:
+        /**
+         * The header of a block.
+         */
+        struct Block {
+            std::string_view id{};          ///< The thermostat identifier.
+            LocalSeconds first{0}, last{0}; ///< The times of the first and last rows.
+            std::uint32_t rows{0};
+            std::uint32_t rawBytes{0};      ///< The size of the body once inflated.
+            std::string_view body{};        ///< The compressed body.
+        };
+
+    private:
+        MappedFile mFile{};
+        std::vector<Block> mBlocks{};       ///< The blocks in the order they were appended.
+
+    public:
+        /**
+         * @param path The archive file.
+         * @throws ArchiveError if the file can not be mapped.
+         */
+        explicit ArchiveReader(const std::filesystem::path &path);
+
+        /**
+         * @brief True if a file starts with an archive block.
+         */
+        static bool isArchive(const std::filesystem::path &path);
+
+        [[nodiscard]] const std::vector<Block> &blocks() const {
+            return mBlocks;
+        }
+
+        /**
+         * @brief Write the archived rows of a thermostat, block by block in the order they were appended.
+         * @details The batch is not flushed.
+         * @param id The thermostat identifier.
+         * @param seriesKeys The thermostat's series keys.
+         * @param influx The batch the rows are written to.
+         * @param from The earliest row to write.
+         * @throws ArchiveError if a block can not be decoded.
+         * @return The number of rows written.
+         */
+        std::size_t replay(std::string_view id, SeriesKeys &seriesKeys, InfluxBatch &influx,
+                           LocalSeconds from = std::numeric_limits<LocalSeconds>::min()) const;
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_REPORTARCHIVE_H
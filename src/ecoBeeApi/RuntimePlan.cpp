@@ -0,0 +1,231 @@
+/**
+ * @file RuntimePlan.cpp
+ */
+
+#include <array>
+#include <charconv>
+#include <map>
+#include "RuntimePlan.h"
+#include "Api.h"
+#include "Tokens.h"
+
+namespace ecoBee {
+
+    namespace {
+        std::vector<Sensor> reportSensors(const nlohmann::json &data) {
+            std::vector<Sensor> sensors{};
+            for (auto &sensor : data["sensorList"][0]["sensors"]) {
+                sensors.emplace_back(sensor["sensorId"], sensor["sensorName"], sensor["sensorType"],
+                                     sensor["sensorUsage"]);
+            }
+            return sensors;
+        }
+
+        std::vector<std::string> reportSensorColumns(const nlohmann::json &data) {
+            std::vector<std::string> columns{};
+            for (auto &column : data["sensorList"][0]["columns"])
+                columns.emplace_back(column.get_ref<const std::string&>());
+            return columns;
+        }
+    }
+
+    RuntimePlan::RuntimePlan(const nlohmann::json &data, SeriesKeys &seriesKeys)
+            : RuntimePlan(data["columns"].get_ref<const std::string&>(), reportSensors(data),
+                          reportSensorColumns(data), seriesKeys) {}
+
+    RuntimePlan::RuntimePlan(std::string_view columns, const std::vector<Sensor> &sensors,
+                             const std::vector<std::string> &sensorColumns, SeriesKeys &seriesKeys)
+            : mColumnCount(2), mSensorCount(0),
+              mSetPointKey(seriesKeys.key("SetPoint")), mFanKey(seriesKeys.key("Fan")),
+              mHeatKey(seriesKeys.key("Heat")), mCoolKey(seriesKeys.key("Cool")) {
+        // Points by category then name, a later column or sensor with the same name replaces an earlier one.
+        std::map<std::string_view, Point> humidity{}, temperature{}, airPressure{};
+        auto addColumn = [&seriesKeys](std::map<std::string_view, Point> &category, std::string_view name,
+                                       Converter converter, std::size_t column) {
+            category.insert_or_assign(name, Point{&seriesKeys.key(name), converter, column, npos});
+        };
+
+        for (auto column : Tokens{columns, ','}) {
+            auto field = mColumnCount++;
+            if (OperationTimeParam.find(column) != std::string_view::npos) {
+                if (column == "fan")
+                    mFan = field;
+                else if (column == "auxHeat1")
+                    mHeat = field;
+                else if (column == "compCool1")
+                    mCool = field;
+            } else if (OperationStateParam.find(column) != std::string_view::npos) {
+                if (column == "hvacMode")
+                    mHvacMode = field;
+                else if (column == "zoneHvacMode")
+                    mZoneHvacMode = field;
+            } else if (column.find("zoneHeatTemp") != std::string_view::npos ||
+                       column.find("zoneCoolTemp") != std::string_view::npos) {
+                if (column == "zoneHeatTemp")
+                    mHeatSetPoint = field;
+                else if (column == "zoneCoolTemp")
+                    mCoolSetPoint = field;
+            } else if (column.find("Humidity") != std::string_view::npos) {
+                addColumn(humidity, column, Converter::None, field);
+            } else if (column.find("Temp") != std::string_view::npos) {
+                addColumn(temperature, column, Converter::FtoC, field);
+                if (column == "outdoorTemp") {
+                    mOutdoorTemp = field;
+                    mOutdoorKey = &seriesKeys.key(column);
+                }
+            }
+        }
+
+        // Sensor columns are sensor ID strings, the first sensor with an ID describes it.
+        std::map<std::string_view, const Sensor &> sensorIds{};
+        for (const auto &sensor : sensors)
+            sensorIds.emplace(sensor.id, sensor);
+
+        mSensorCount = sensorColumns.size();
+        for (std::size_t field = 2; field < mSensorCount; ++field) {
+            auto sensor = sensorIds.find(sensorColumns[field]);
+            if (sensor == sensorIds.end())
+                continue;
+
+            std::map<std::string_view, Point> *category;
+            Converter converter;
+            switch (sensor->second.type) {
+                case Sensor::temperature:
+                    category = &temperature;
+                    converter = Converter::FtoC;
+                    break;
+                case Sensor::humidity:
+                    category = &humidity;
+                    converter = Converter::None;
+                    break;
+                case Sensor::airPressure:
+                    category = &airPressure;
+                    converter = Converter::HectoPascals;
+                    break;
+                default:
+                    continue;
+            }
+
+            // The column value, if any, is kept for rows where the sensor row is not valid.
+            const auto &name = sensor->second.name;
+            auto [point, added] = category->try_emplace(name, Point{&seriesKeys.key(name), converter});
+            point->second.converter = converter;
+            point->second.sensor = field;
+        }
+
+        for (auto *category : {&humidity, &temperature, &airPressure}) {
+            for (auto &[name, point] : *category)
+                mPoints.push_back(point);
+        }
+    }
+
+    std::optional<std::string>
+    RuntimePlan::writeRow(InfluxBatch &influx, std::string_view reportRow, std::string_view sensorRow) {
+        mReportFields.clear();
+        for (auto field : Tokens{reportRow, ','})
+            mReportFields.push_back(field);
+        mSensorFields.clear();
+        for (auto field : Tokens{sensorRow, ','})
+            mSensorFields.push_back(field);
+
+        // Rows without a field for every column can not be written.
+        if (!matches(mReportFields))
+            return std::nullopt;
+
+        if (mReportFields.at(2).empty() || mSensorFields.at(2).empty()) {
+            return std::nullopt;    // Skipp lines with incomplete data but continue scan in case more data follows.
+        }
+
+        write(influx, mReportFields, mSensorFields);
+        return localToGMT(std::string{mReportFields[0]}, std::string{mReportFields[1]});
+    }
+
+    void RuntimePlan::write(InfluxBatch &influx, Fields report, Fields sensors) const {
+        auto sensorsValid = sensors.size() == mSensorCount;
+        auto field = [report](std::size_t column) {
+            return column == npos ? std::string_view{} : report[column];
+        };
+
+        influx.newMeasurements();
+        influx.setMeasurementEpoch(report[0], report[1]);
+        bool dataWritten = false;
+
+        for (const auto &point : mPoints) {
+            std::string_view value;
+            if (sensorsValid && point.sensor != npos)
+                value = sensors[point.sensor];
+            else if (point.column != npos)
+                value = report[point.column];
+            else
+                continue;
+
+            switch (point.converter) {
+                case Converter::None:
+                    dataWritten |= influx.addPoint(*point.key, value);
+                    break;
+                case Converter::FtoC:
+                    if (auto number = parseNumber(value); number)
+                        dataWritten |= influx.addPoint(*point.key, FtoC(number.value()));
+                    break;
+                case Converter::HectoPascals:
+                    if (auto number = parseNumber(value); number)
+                        dataWritten |= influx.addPoint(*point.key, hectoPascals(number.value()));
+                    break;
+            }
+        }
+
+        if (auto number = parseNumber(field(mOutdoorTemp)); number)
+            influx.addDegrees(*mOutdoorKey, FtoC(number.value()));
+
+        auto setPoint = [&](std::size_t column) {
+            if (auto number = parseNumber(field(column)); number)
+                dataWritten |= influx.addState(mSetPointKey, FtoC(number.value()));
+        };
+        if (field(mHvacMode) == "heat")
+            setPoint(mHeatSetPoint);
+        else if (field(mZoneHvacMode) == "cool")
+            setPoint(mCoolSetPoint);
+
+        /*
+         * Time specified operations
+         *
+         */
+
+        struct TimeOp {
+            const std::string &key;
+            std::size_t column;
+            bool state{false};
+            unsigned long seconds{0};
+        };
+
+        std::array<TimeOp, 3> timeOpList{{{mFanKey, mFan}, {mHeatKey, mHeat}, {mCoolKey, mCool}}};
+
+        auto HVACmode = field(mZoneHvacMode);
+        if (HVACmode == "heatStage1On") {
+            timeOpList[0].state = timeOpList[1].state = true;
+        } else if (HVACmode == "compressorCoolStage1On") {
+            timeOpList[0].state = timeOpList[2].state = true;
+        }
+
+        for (auto &op : timeOpList) {
+            auto seconds = field(op.column);
+            std::from_chars(seconds.data(), seconds.data() + seconds.size(), op.seconds);
+            if (!seconds.empty())
+                influx.addRuntime(op.key, static_cast<double>(op.seconds));
+            auto timestamp = influx.getMeasurementEpoch();
+            op.state &= op.seconds != 0;
+            op.state |= op.seconds == 300;
+            if (op.seconds != 0 && op.seconds != 300) {
+                if (op.state)
+                    timestamp += op.seconds * 1000000000;
+                else
+                    timestamp -= (300 - op.seconds) * 1000000000;
+            }
+            dataWritten |= influx.addState(op.key, (op.state ? "true" : "false"), timestamp);
+        }
+
+        if (dataWritten)
+            influx.pushData();
+    }
+
+} // ecoBee
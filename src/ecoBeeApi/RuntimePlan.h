@@ -0,0 +1,121 @@
+/**
+ * @file RuntimePlan.h
+ * @brief How the columns of a runtime report are written to the database.
+ * @details The report columns and sensors are classified once per report. Each row is then written
+ * straight from its fields by following the plan.
+ */
+
+#ifndef ECOBEEDATA_RUNTIMEPLAN_H
+#define ECOBEEDATA_RUNTIMEPLAN_H
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "InfluxBatch.h"
+#include "SeriesKeys.h"
+#include "Api.h"
+
+namespace ecoBee {
+
+    /**
+     * @class RuntimePlan
+     * @details Columns are classified in this order, the first match wins:
+     *  - Operations time, the column is one of OperationTimeParam.
+     *  - Operations state, the column is one of OperationStateParam.
+     *  - Set points, the column contains zoneHeatTemp or zoneCoolTemp.
+     *  - Humidity, the column contains Humidity.
+     *  - Temperature, the column contains Temp.
+     * Other columns are not written. Sensors are classified by type, occupancy is not written. A sensor with
+     * the same name as a column replaces the column value when the sensor row is valid. Points are written
+     * humidity, temperature then air pressure, each in name order, followed by the set point and the fan,
+     * heat and cool states. The fan, heat and cool seconds are added to the rollup as runtimes and the
+     * outdoorTemp column as degree hours of its series.
+     */
+    class RuntimePlan {
+    public:
+        using Fields = std::span<const std::string_view>;
+        static constexpr std::size_t npos = std::string_view::npos;
+
+        enum class Converter {
+            None,           ///< Written as reported.
+            FtoC,           ///< Fahrenheit to Celsius.
+            HectoPascals,   ///< Pascals to hecto Pascals.
+        };
+
+        struct Point {
+            const std::string *key;     ///< The interned series key.
+            Converter converter;
+            std::size_t column{npos};   ///< The report row field, npos if none.
+            std::size_t sensor{npos};   ///< The sensor row field, npos if none.
+        };
+
+    private:
+        std::vector<Point> mPoints{};   ///< Humidity, temperature and air pressure points in write order.
+        std::size_t mColumnCount;       ///< Fields in a valid report row, including the date and time.
+        std::size_t mSensorCount;       ///< Fields in a valid sensor row, including the date and time.
+        std::size_t mHvacMode{npos}, mZoneHvacMode{npos};
+        std::size_t mHeatSetPoint{npos}, mCoolSetPoint{npos};
+        std::size_t mFan{npos}, mHeat{npos}, mCool{npos};
+        std::size_t mOutdoorTemp{npos};
+        const std::string *mOutdoorKey{nullptr};
+        const std::string &mSetPointKey;
+        const std::string &mFanKey;
+        const std::string &mHeatKey;
+        const std::string &mCoolKey;
+        std::vector<std::string_view> mReportFields{};  ///< The fields of the current report row.
+        std::vector<std::string_view> mSensorFields{};  ///< The fields of the current sensor row.
+
+    public:
+        RuntimePlan() = delete;
+
+        /**
+         * @param columns The report columns, comma separated.
+         * @param sensors The sensors of the thermostat, the first sensor with an ID describes it.
+         * @param sensorColumns The sensor row columns, the date, time then sensor IDs.
+         * @param seriesKeys The series keys, they must outlive the plan.
+         */
+        RuntimePlan(std::string_view columns, const std::vector<Sensor> &sensors,
+                    const std::vector<std::string> &sensorColumns, SeriesKeys &seriesKeys);
+
+        /**
+         * @param data The runtime report.
+         * @param seriesKeys The series keys, they must outlive the plan.
+         */
+        RuntimePlan(const nlohmann::json &data, SeriesKeys &seriesKeys);
+
+        /**
+         * @brief True if a report row has a field for every column.
+         */
+        [[nodiscard]] bool matches(Fields report) const {
+            return report.size() == mColumnCount;
+        }
+
+        /**
+         * @brief Write one row as a measurement set.
+         * @param influx The batch the measurement set is pushed to.
+         * @param report The report row fields, matches() must be true.
+         * @param sensors The sensor row fields, they are not used unless there is one for every sensor column.
+         */
+        void write(InfluxBatch &influx, Fields report, Fields sensors) const;
+
+        /**
+         * @brief Tokenize a report row and its sensor row and write them if the row has complete data.
+         * @param influx The batch the measurement set is pushed to.
+         * @param reportRow The report row.
+         * @param sensorRow The sensor row.
+         * @return The GMT time of the row if it was written.
+         * @throws std::out_of_range if the sensor row has no sensor fields.
+         */
+        std::optional<std::string> writeRow(InfluxBatch &influx, std::string_view reportRow, std::string_view sensorRow);
+
+        [[nodiscard]] const std::vector<Point> &points() const {
+            return mPoints;
+        }
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_RUNTIMEPLAN_H
@@ -0,0 +1,314 @@
+/**
+ * @file RuntimeReportReader.cpp
+ */
+
+#include <limits>
+#include "RuntimeReportReader.h"
+#include "Api.h"
+
+namespace ecoBee {
+
+    RuntimeReportReader::RuntimeReportReader(std::vector<Target> targets)
+            : mTargets(std::move(targets)), mReportMatched(mTargets.size(), false),
+              mSensorsMatched(mTargets.size(), false) {
+        for (auto &target : mTargets)
+            mWriters.push_back(std::make_unique<ThermostatWriter>(*target.influx, target.prefix, target.lastData,
+                                                                target.window));
+    }
+
+    RuntimeReportReader::RuntimeReportReader(InfluxBatch &influx, std::string lastData)
+            : RuntimeReportReader(std::vector<Target>{Target{{}, "Home ", &influx, std::move(lastData)}}) {}
+
+    void RuntimeReportReader::parse(std::istream &stream) {
+        if (!json::sax_parse(stream, this))
+            throw ApiError(ysh::StringComposite("Runtime report: ", mError));
+    }
+
+    void RuntimeReportReader::finish() {
+        // Every writer finishes in parallel before any error is reported.
+        for (auto &writer : mWriters)
+            writer->close();
+
+        std::exception_ptr error{};
+        for (std::size_t idx = 0; idx < mWriters.size(); ++idx) {
+            try {
+                mTargets[idx].lastData = mWriters[idx]->finish();
+            } catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    const std::string &RuntimeReportReader::lastData(std::string_view id) const {
+        for (const auto &target : mTargets) {
+            if (target.id == id)
+                return target.lastData;
+        }
+        throw ApiError(ysh::StringComposite("Thermostat not in report: ", id));
+    }
+
+    std::optional<std::size_t> RuntimeReportReader::target(std::string_view id, const std::vector<bool> &matched) const {
+        std::optional<std::size_t> unmatched{};
+        for (std::size_t idx = 0; idx < mTargets.size(); ++idx) {
+            if (!id.empty() && mTargets[idx].id == id)
+                return matched[idx] ? std::nullopt : std::optional{idx};
+            if (!unmatched && mTargets[idx].id.empty() && !matched[idx])
+                unmatched = idx;
+        }
+        return unmatched;
+    }
+
+    void RuntimeReportReader::bind(std::string_view id, std::vector<bool> &matched) {
+        if (mEntry.bound)
+            return;
+
+        mEntry.bound = true;
+        auto idx = target(id, matched);
+        if (!idx) {
+            mEntry = Entry{true};
+            return;
+        }
+
+        matched[idx.value()] = true;
+        auto &writer = *mWriters[idx.value()];
+        mEntry.writer = &writer;
+        if (mEntry.rowCount)
+            writer.rowCount(mEntry.rowCount.value());
+        for (auto &row : mEntry.rows) {
+            if (&matched == &mReportMatched)
+                writer.reportRow(std::move(row));
+            else
+                writer.sensorRow(std::move(row));
+        }
+        mEntry.rows.clear();
+        if (mEntry.sensors)
+            writer.sensors(std::move(mEntry.sensors.value()));
+        if (mEntry.sensorColumns)
+            writer.sensorColumns(std::move(mEntry.sensorColumns.value()));
+    }
+
+    RuntimeReportReader::Context RuntimeReportReader::child(bool isObject) {
+        if (mFrames.empty())
+            return isObject ? Context::Top : Context::Ignore;
+
+        switch (mFrames.back()) {
+            case Context::Top:
+                if (!isObject && mKey == "reportList")
+                    return Context::ReportList;
+                if (!isObject && mKey == "sensorList")
+                    return Context::SensorLists;
+                if (isObject && mKey == "status")
+                    return Context::Status;
+                break;
+            case Context::ReportList:
+                if (isObject)
+                    return Context::Report;
+                break;
+            case Context::Report:
+                if (!isObject && mKey == "rowList")
+                    return Context::RowList;
+                break;
+            case Context::SensorLists:
+                if (isObject)
+                    return Context::SensorList;
+                break;
+            case Context::SensorList:
+                if (!isObject && mKey == "sensors")
+                    return Context::Sensors;
+                if (!isObject && mKey == "columns")
+                    return Context::SensorColumns;
+                if (!isObject && mKey == "data")
+                    return Context::SensorData;
+                break;
+            case Context::Sensors:
+                if (isObject)
+                    return Context::Sensor;
+                break;
+            default:
+                break;
+        }
+        return Context::Ignore;
+    }
+
+    bool RuntimeReportReader::start(Context context) {
+        switch (context) {
+            case Context::Report:
+            case Context::SensorList:
+                mEntry = Entry{};
+                break;
+            case Context::Sensors:
+                mSensors.clear();
+                break;
+            case Context::SensorColumns:
+                mSensorColumns.clear();
+                break;
+            case Context::Sensor:
+                mSensorFields.assign(4, std::string{});
+                break;
+            default:
+                break;
+        }
+        mFrames.push_back(context);
+        return true;
+    }
+
+    bool RuntimeReportReader::number(long value) {
+        if (mFrames.empty())
+            return true;
+
+        auto context = mFrames.back();
+        if (context == Context::Report && mKey == "rowCount") {
+            auto count = value > 0 ? static_cast<std::size_t>(value) : 0;
+            if (mEntry.writer)
+                mEntry.writer->rowCount(count);
+            else if (!mEntry.bound)
+                mEntry.rowCount = count;
+        } else if (context == Context::Status && mKey == "code") {
+            mStatusCode = value;
+        }
+        return true;
+    }
+
+    bool RuntimeReportReader::null() {
+        return true;
+    }
+
+    bool RuntimeReportReader::boolean(bool) {
+        return true;
+    }
+
+    bool RuntimeReportReader::number_integer(number_integer_t val) {
+        return number(static_cast<long>(val));
+    }
+
+    bool RuntimeReportReader::number_unsigned(number_unsigned_t val) {
+        return number(val > static_cast<number_unsigned_t>(std::numeric_limits<long>::max())
+                      ? std::numeric_limits<long>::max() : static_cast<long>(val));
+    }
+
+    bool RuntimeReportReader::number_float(number_float_t, const string_t &) {
+        return true;
+    }
+
+    bool RuntimeReportReader::string(string_t &val) {
+        if (mFrames.empty())
+            return true;
+
+        switch (mFrames.back()) {
+            case Context::Top:
+                if (mKey == "columns") {
+                    for (auto &writer : mWriters)
+                        writer->columns(val);
+                }
+                break;
+            case Context::Report:
+                if (mKey == "thermostatIdentifier")
+                    bind(val, mReportMatched);
+                break;
+            case Context::SensorList:
+                if (mKey == "thermostatIdentifier")
+                    bind(val, mSensorsMatched);
+                break;
+            case Context::RowList:
+                if (mEntry.writer)
+                    mEntry.writer->reportRow(std::move(val));
+                else if (!mEntry.bound)
+                    mEntry.rows.push_back(std::move(val));
+                break;
+            case Context::SensorData:
+                if (mEntry.writer)
+                    mEntry.writer->sensorRow(std::move(val));
+                else if (!mEntry.bound)
+                    mEntry.rows.push_back(std::move(val));
+                break;
+            case Context::SensorColumns:
+                mSensorColumns.push_back(std::move(val));
+                break;
+            case Context::Sensor:
+                if (mKey == "sensorId")
+                    mSensorFields[0] = std::move(val);
+                else if (mKey == "sensorName")
+                    mSensorFields[1] = std::move(val);
+                else if (mKey == "sensorType")
+                    mSensorFields[2] = std::move(val);
+                else if (mKey == "sensorUsage")
+                    mSensorFields[3] = std::move(val);
+                break;
+            case Context::Status:
+                if (mKey == "message")
+                    mStatusMessage = std::move(val);
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    bool RuntimeReportReader::binary(binary_t &) {
+        return true;
+    }
+
+    bool RuntimeReportReader::start_object(std::size_t) {
+        return start(child(true));
+    }
+
+    bool RuntimeReportReader::key(string_t &val) {
+        mKey = std::move(val);
+        return true;
+    }
+
+    bool RuntimeReportReader::end_object() {
+        auto context = mFrames.back();
+        mFrames.pop_back();
+        switch (context) {
+            case Context::Sensor:
+                mSensors.emplace_back(std::move(mSensorFields[0]), std::move(mSensorFields[1]), mSensorFields[2],
+                                      std::move(mSensorFields[3]));
+                break;
+            case Context::Report:
+                bind({}, mReportMatched);
+                break;
+            case Context::SensorList:
+                // The plan needs both, an entry without them has no sensors.
+                if (!mEntry.bound && !mEntry.sensors)
+                    mEntry.sensors.emplace();
+                if (!mEntry.bound && !mEntry.sensorColumns)
+                    mEntry.sensorColumns.emplace();
+                bind({}, mSensorsMatched);
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    bool RuntimeReportReader::start_array(std::size_t) {
+        return start(child(false));
+    }
+
+    bool RuntimeReportReader::end_array() {
+        auto context = mFrames.back();
+        mFrames.pop_back();
+        if (context == Context::Sensors) {
+            if (mEntry.writer)
+                mEntry.writer->sensors(std::move(mSensors));
+            else if (!mEntry.bound)
+                mEntry.sensors = std::move(mSensors);
+        } else if (context == Context::SensorColumns) {
+            if (mEntry.writer)
+                mEntry.writer->sensorColumns(std::move(mSensorColumns));
+            else if (!mEntry.bound)
+                mEntry.sensorColumns = std::move(mSensorColumns);
+        }
+        return true;
+    }
+
+    bool RuntimeReportReader::parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) {
+        mError = ex.what();
+        return false;
+    }
+
+} // ecoBee
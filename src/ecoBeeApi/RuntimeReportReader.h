@@ -0,0 +1,173 @@
+/**
+ * @file RuntimeReportReader.h
+ * @brief Write a runtime report to the database while it is being parsed.
+ * @details The report is read through the nlohmann SAX interface so no document is built. Each thermostat
+ * in the report is handed to a ThermostatWriter of its own, which writes its rows in parallel with the others
+ * as soon as its report rows, sensor rows and RuntimePlan are available. The report rows precede the sensor
+ * data in a response, so they are held until their sensor rows arrive.
+ */
+
+#ifndef ECOBEEDATA_RUNTIMEREPORTREADER_H
+#define ECOBEEDATA_RUNTIMEREPORTREADER_H
+
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "InfluxBatch.h"
+#include "ThermostatWriter.h"
+
+namespace ecoBee {
+
+    /**
+     * @class RuntimeReportReader
+     * @details The reportList and sensorList entries are matched to thermostats by their thermostatIdentifier.
+     * A thermostat with an empty identifier takes the first entry of each list not matched by identifier.
+     * Entries for other thermostats, and everything besides the columns, rows, sensors and status, are skipped.
+     */
+    class RuntimeReportReader : public nlohmann::json_sax<nlohmann::json> {
+    public:
+        using json = nlohmann::json;
+
+        /**
+         * A thermostat expected in the report.
+         */
+        struct Target {
+            std::string id{};           ///< The thermostat identifier, empty for the first unmatched entry.
+            std::string prefix{};       ///< The measurement name prefix, for example "Home ".
+            InfluxBatch *influx{};      ///< The batch the thermostat's rows are written to.
+            std::string lastData{};     ///< The time of the last row already written.
+            ReportWindow *window{};     ///< If not nullptr the rows written are added to it.
+        };
+
+    private:
+        enum class Context {
+            Ignore,         ///< A value that is not read.
+            Top,            ///< The report object.
+            ReportList,     ///< The reportList array.
+            Report,         ///< A reportList object.
+            RowList,        ///< The rowList array of report rows.
+            SensorLists,    ///< The sensorList array.
+            SensorList,     ///< A sensorList object.
+            Sensors,        ///< The sensors array.
+            Sensor,         ///< A sensors object.
+            SensorColumns,  ///< The sensor row columns array.
+            SensorData,     ///< The data array of sensor rows.
+            Status,         ///< The status object.
+        };
+
+        /**
+         * The reportList or sensorList entry being read. Its parts are held until its thermostat is known.
+         */
+        struct Entry {
+            bool bound{false};                  ///< The thermostat is known, or the entry is not read.
+            ThermostatWriter *writer{nullptr};  ///< The thermostat's writer, nullptr if the entry is not read.
+            std::optional<std::size_t> rowCount{};
+            std::vector<std::string> rows{};
+            std::optional<std::vector<ecoBee::Sensor>> sensors{};
+            std::optional<std::vector<std::string>> sensorColumns{};
+        };
+
+        std::vector<Target> mTargets;
+        std::vector<std::unique_ptr<ThermostatWriter>> mWriters{};  ///< A writer for each target.
+        std::vector<bool> mReportMatched{}, mSensorsMatched{};      ///< A list entry was matched to the target.
+        std::vector<Context> mFrames{};             ///< The contexts of the open objects and arrays.
+        std::string mKey{};                         ///< The key of the next value of an object.
+
+        Entry mEntry{};
+        std::vector<ecoBee::Sensor> mSensors{};
+        std::vector<std::string> mSensorColumns{};
+        std::vector<std::string> mSensorFields{};   ///< Id, name, type and usage of the sensor being read.
+
+        std::optional<long> mStatusCode{};
+        std::string mStatusMessage{};
+        std::string mError{};
+
+        /**
+         * @brief The context of a value started in the current frame.
+         */
+        Context child(bool isObject);
+
+        bool start(Context context);
+
+        /**
+         * @brief Match the current entry to a thermostat and hand over what has been held.
+         * @param id The thermostatIdentifier of the entry, empty if it had none.
+         * @param matched Which targets already have an entry from this list.
+         */
+        void bind(std::string_view id, std::vector<bool> &matched);
+
+        /**
+         * @brief The index of a thermostat's target, or of the target taking unmatched entries.
+         */
+        [[nodiscard]] std::optional<std::size_t> target(std::string_view id, const std::vector<bool> &matched) const;
+
+        bool number(long value);
+
+    public:
+        RuntimeReportReader() = delete;
+
+        /**
+         * @param targets The thermostats expected in the report, the batches must outlive the reader.
+         */
+        explicit RuntimeReportReader(std::vector<Target> targets);
+
+        /**
+         * @brief Read a report of a single thermostat.
+         * @param influx The batch rows are written to, it must outlive the reader.
+         * @param lastData The time of the last row already written.
+         */
+        RuntimeReportReader(InfluxBatch &influx, std::string lastData);
+
+        /**
+         * @brief Parse a report from a stream.
+         * @throws ApiError if the stream is not valid JSON.
+         */
+        void parse(std::istream &stream);
+
+        /**
+         * @brief Write the remaining rows of every thermostat and flush their batches.
+         * @details Call only once the status is known to be OK.
+         * @throws The first error met writing a thermostat's rows, after every thermostat has finished.
+         */
+        void finish();
+
+        /**
+         * @brief The GMT time of the last row written for a thermostat, valid after finish().
+         * @param id The thermostat identifier, empty for the target taking unmatched entries.
+         */
+        [[nodiscard]] const std::string &lastData(std::string_view id = {}) const;
+
+        /**
+         * @brief The report status code, -1 if the report had none.
+         */
+        [[nodiscard]] long statusCode() const {
+            return mStatusCode.value_or(-1);
+        }
+
+        [[nodiscard]] const std::string &statusMessage() const {
+            return mStatusMessage;
+        }
+
+        bool null() override;
+        bool boolean(bool val) override;
+        bool number_integer(number_integer_t val) override;
+        bool number_unsigned(number_unsigned_t val) override;
+        bool number_float(number_float_t val, const string_t &s) override;
+        bool string(string_t &val) override;
+        bool binary(binary_t &val) override;
+        bool start_object(std::size_t elements) override;
+        bool key(string_t &val) override;
+        bool end_object() override;
+        bool start_array(std::size_t elements) override;
+        bool end_array() override;
+        bool parse_error(std::size_t position, const std::string &last_token,
+                         const nlohmann::detail::exception &ex) override;
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_RUNTIMEREPORTREADER_H
@@ -0,0 +1,144 @@
+/**
+ * @file ThermostatWriter.cpp
+ */
+
+#include "ThermostatWriter.h"
+#include "Api.h"
+#include "ReportArchive.h"
+
+namespace ecoBee {
+
+    ThermostatWriter::ThermostatWriter(InfluxBatch &influx, std::string prefix, std::string lastData,
+                                       ReportWindow *window)
+            : mInflux(influx), mSeriesKeys(std::move(prefix)), mLastData(std::move(lastData)), mWindow(window),
+              mWorker([this]() { write(); }) {}
+
+    ThermostatWriter::~ThermostatWriter() {
+        std::lock_guard lock{mMutex};
+        mStopped = true;
+        mChanged.notify_all();
+    }
+
+    void ThermostatWriter::write() {
+        try {
+            std::optional<RuntimePlan> plan{};
+            std::size_t written{0};
+            auto planReady = [&]() { return !plan && mColumns && mSensors && mSensorColumns; };
+            auto rowReady = [&]() {
+                return plan && mRowCount && written < mRowCount.value() && !mReportRows.empty() &&
+                       (mFinal || !mSensorRows.empty());
+            };
+
+            std::unique_lock lock{mMutex};
+            for (;;) {
+                mChanged.wait(lock, [&]() { return mStopped || mFinal || planReady() || rowReady(); });
+                if (mStopped)
+                    return;
+
+                if (planReady()) {
+                    plan.emplace(mColumns.value(), mSensors.value(), mSensorColumns.value(), mSeriesKeys);
+                    if (mWindow)
+                        mWindow->describe(mColumns.value(), mSensors.value(), mSensorColumns.value());
+                } else if (!plan && mFinal && !mReportRows.empty()) {
+                    if (!mColumns)
+                        throw ApiError("Runtime report has rows but no columns.");
+                    mSensors = mSensors.value_or(std::vector<ecoBee::Sensor>{});
+                    mSensorColumns = mSensorColumns.value_or(std::vector<std::string>{});
+                    plan.emplace(mColumns.value(), mSensors.value(), mSensorColumns.value(), mSeriesKeys);
+                    if (mWindow)
+                        mWindow->describe(mColumns.value(), mSensors.value(), mSensorColumns.value());
+                }
+
+                // Rows are written without the lock so the parser is not held up.
+                while (rowReady()) {
+                    auto reportRow = std::move(mReportRows.front());
+                    mReportRows.pop_front();
+                    std::string sensorRow{};
+                    if (!mSensorRows.empty()) {
+                        sensorRow = std::move(mSensorRows.front());
+                        mSensorRows.pop_front();
+                    }
+
+                    lock.unlock();
+                    if (auto rowTime = plan->writeRow(mInflux, reportRow, sensorRow); rowTime) {
+                        mLastData = std::move(rowTime.value());
+                        if (mWindow)
+                            mWindow->add(reportRow, sensorRow);
+                    }
+                    lock.lock();
+                    ++written;
+                }
+
+                if (mFinal)
+                    break;
+            }
+            mReportRows.clear();
+            mSensorRows.clear();
+            lock.unlock();
+
+            // Write the rest of the batch, a failure throws before lastData is advanced.
+            mInflux.flush();
+        } catch (...) {
+            std::lock_guard lock{mMutex};
+            mError = std::current_exception();
+        }
+    }
+
+    void ThermostatWriter::columns(const std::string &columns) {
+        std::lock_guard lock{mMutex};
+        mColumns = columns;
+        mChanged.notify_all();
+    }
+
+    void ThermostatWriter::sensors(std::vector<ecoBee::Sensor> sensors) {
+        std::lock_guard lock{mMutex};
+        mSensors = std::move(sensors);
+        mChanged.notify_all();
+    }
+
+    void ThermostatWriter::sensorColumns(std::vector<std::string> columns) {
+        std::lock_guard lock{mMutex};
+        mSensorColumns = std::move(columns);
+        mChanged.notify_all();
+    }
+
+    void ThermostatWriter::rowCount(std::size_t count) {
+        std::lock_guard lock{mMutex};
+        mRowCount = count;
+        mChanged.notify_all();
+    }
+
+    void ThermostatWriter::reportRow(std::string row) {
+        std::lock_guard lock{mMutex};
+        if (!mRowCount || mReportRowsRead < mRowCount.value()) {
+            mReportRows.push_back(std::move(row));
+            mChanged.notify_all();
+        }
+        ++mReportRowsRead;
+    }
+
+    void ThermostatWriter::sensorRow(std::string row) {
+        std::lock_guard lock{mMutex};
+        if (!mRowCount || mSensorRowsRead < mRowCount.value()) {
+            mSensorRows.push_back(std::move(row));
+            mChanged.notify_all();
+        }
+        ++mSensorRowsRead;
+    }
+
+    void ThermostatWriter::close() {
+        std::lock_guard lock{mMutex};
+        mFinal = true;
+        mChanged.notify_all();
+    }
+
+    std::string ThermostatWriter::finish() {
+        close();
+        if (mWorker.joinable())
+            mWorker.join();
+        if (mError)
+            std::rethrow_exception(mError);
+        return mLastData;
+    }
+
+} // ecoBee
@@ -0,0 +1,106 @@
+/**
+ * @file ThermostatWriter.h
+ * @brief Write the rows of one thermostat of a runtime report on a thread of its own.
+ * @details The report parser hands over the parts of a thermostat's report as they are parsed. The writer
+ * pairs each report row with its sensor row and writes it once the RuntimePlan can be built, so the
+ * thermostats of a report are written in parallel while the report is still being parsed.
+ */
+
+#ifndef ECOBEEDATA_THERMOSTATWRITER_H
+#define ECOBEEDATA_THERMOSTATWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "InfluxBatch.h"
+#include "RuntimePlan.h"
+#include "SeriesKeys.h"
+
+namespace ecoBee {
+
+    class ReportWindow;
+
+    /**
+     * @class ThermostatWriter
+     */
+    class ThermostatWriter {
+        InfluxBatch &mInflux;
+        SeriesKeys mSeriesKeys;
+        std::string mLastData;
+        ReportWindow *mWindow;
+
+        std::mutex mMutex{};
+        std::condition_variable mChanged{};
+        std::optional<std::string> mColumns{};
+        std::optional<std::vector<ecoBee::Sensor>> mSensors{};
+        std::optional<std::vector<std::string>> mSensorColumns{};
+        std::optional<std::size_t> mRowCount{};
+        std::deque<std::string> mReportRows{}, mSensorRows{};
+        std::size_t mReportRowsRead{0}, mSensorRowsRead{0};  ///< Rows handed over, including those written.
+        bool mFinal{false};             ///< Nothing more will be handed over.
+        bool mStopped{false};           ///< Stop without writing the rest.
+        std::exception_ptr mError{};
+        std::jthread mWorker;           ///< Started last, the members it uses are constructed before it.
+
+        void write();
+
+    public:
+        ThermostatWriter() = delete;
+        ThermostatWriter(const ThermostatWriter &) = delete;
+        ThermostatWriter &operator=(const ThermostatWriter &) = delete;
+
+        /**
+         * @param influx The batch the rows are written to, used only by this writer until finish() returns.
+         * @param prefix The measurement name prefix, for example "Home ".
+         * @param lastData The time of the last row already written.
+         * @param window If not nullptr the rows written are added to it, used only by this writer until finish()
+         * returns.
+         */
+        ThermostatWriter(InfluxBatch &influx, std::string prefix, std::string lastData,
+                         ReportWindow *window = nullptr);
+
+        /**
+         * @brief Stop the worker, rows not yet written are discarded.
+         */
+        ~ThermostatWriter();
+
+        void columns(const std::string &columns);
+
+        void sensors(std::vector<ecoBee::Sensor> sensors);
+
+        void sensorColumns(std::vector<std::string> columns);
+
+        void rowCount(std::size_t count);
+
+        void reportRow(std::string row);
+
+        void sensorRow(std::string row);
+
+        /**
+         * @brief Mark the end of the report, the remaining rows are written without waiting for more.
+         */
+        void close();
+
+        /**
+         * @brief Close, then wait for the remaining rows to be written and the batch flushed.
+         * @throws The first error met writing rows.
+         * @return The GMT time of the last row written.
+         */
+        std::string finish();
+
+        /**
+         * @brief The GMT time of the last row written, valid after finish().
+         */
+        [[nodiscard]] const std::string &lastData() const {
+            return mLastData;
+        }
+    };
+
+} // ecoBee
+
+#endif //ECOBEEDATA_THERMOSTATWRITER_H
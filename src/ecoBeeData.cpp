@@ -3,288 +3,492 @@
 //
 
 #include <pwd.h>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
 #include <array>
+#include <charconv>
+#include <deque>
+#include <fstream>
+#include <iterator>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <set>
 #include "ConfigFile.h"
 #include "InputParser.h"
 #include "XDGFilePaths.h"
-#include "InfluxPush.h"
+#include "Api.h"
+#include "InfluxBatch.h"
+#include "EcoBeeDataFile.h"
+#include "Manifest.h"
+#include "AtomicFile.h"
+#include "Spool.h"
+#include "AsyncWriter.h"
+#include "GzipEncoder.h"
+#include "Rollup.h"
 
 using namespace std;
 
 /**
- * @class EcoBeDataFile
- * @brief Abstract the CSV file made available by ecoBee
+ * How report files are read, see EcoBeeDataFile.
  */
-class EcoBeeDataFile {
-public:
-    using DataLine = std::vector<std::string>;
-    using DataFile = std::vector<DataLine>;
-    constexpr static unsigned long MaximumTimeValue = 300;
-    /**
-     * Indexes into the header and data vectors.
-     */
-    enum DataIndex {
-        Date [[maybe_unused]],
-        Time [[maybe_unused]],
-        SystemSetting [[maybe_unused]],
-        SystemMode [[maybe_unused]],
-        CalendarEvent [[maybe_unused]],
-        ProgramMode [[maybe_unused]],
-        CoolSetTemp [[maybe_unused]],
-        HeatSetTemp [[maybe_unused]],
-        CurrentTemp [[maybe_unused]],
-        CurrentHumidity [[maybe_unused]],
-        OutdoorTemp [[maybe_unused]],
-        WindSpeed [[maybe_unused]],
-        CoolStage1Sec [[maybe_unused]],
-        HeatStage1Sec [[maybe_unused]],
-        FanSec [[maybe_unused]],
-        DMOffset [[maybe_unused]],
-        ThermostatTemp [[maybe_unused]],
-        ThermostatHumidity [[maybe_unused]],
-        ThermostatMotion [[maybe_unused]],
-        ThermostatAirPressure [[maybe_unused]],
-        Sensor0Temp [[maybe_unused]],
-        Sensor0Motion [[maybe_unused]],
-        Sensor1Temp [[maybe_unused]],
-        Sensor1Motion [[maybe_unused]],
-        Sensor2Temp [[maybe_unused]],
-        Sensor2Motion [[maybe_unused]],
-        Sensor3Temp [[maybe_unused]],
-        Sensor3Motion [[maybe_unused]],
-    };
+enum class ReadMode {
+    Load,       ///< Copy every field into a std::string.
+    Map,        ///< Memory map the file and use std::string_view fields.
+    Stream,     ///< Memory map the file and push each row as soon as it is parsed.
+    Columnar,   ///< Memory map the file and convert the used columns to typed columns.
+};
 
-    struct StateDataItem {
-        EcoBeeDataFile::DataIndex dataIndex;
-        bool state;
-    };
+static constexpr std::array<EcoBeeDataFile::DataIndex,7> ReportedData = {
+        EcoBeeDataFile::DataIndex::CurrentTemp,
+        EcoBeeDataFile::DataIndex::CurrentHumidity,
+        EcoBeeDataFile::DataIndex::Sensor0Temp,
+        EcoBeeDataFile::DataIndex::Sensor1Temp,
+        EcoBeeDataFile::DataIndex::Sensor2Temp,
+        EcoBeeDataFile::DataIndex::Sensor3Temp,
+        EcoBeeDataFile::DataIndex::ThermostatTemp,
+};
+
+/**
+ * The set points, written as states which may only be written when they change.
+ */
+static constexpr std::array<EcoBeeDataFile::DataIndex,2> SetPointData = {
+        EcoBeeDataFile::DataIndex::CoolSetTemp,
+        EcoBeeDataFile::DataIndex::HeatSetTemp,
+};
 
-private:
-    std::array<char, 3> footPrint{'\357', '\273', '\277'};  ///< Not really sure what this is, let's call it a footprint.
-    bool fileGood{true};    ///< True if the file passes parsing.
-    std::vector<std::string> header{};  ///< The data item headers.
-    DataFile dataFile;                  ///< The data in the file.
+static constexpr std::array<EcoBeeDataFile::StateDataItem,3> TimeStateData = {{
+                                                 {EcoBeeDataFile::DataIndex::FanSec, false },
+                                                 {EcoBeeDataFile::DataIndex::HeatStage1Sec, false },
+                                                 {EcoBeeDataFile::DataIndex::CoolStage1Sec, false },
+                                         }};
 
-public:
-    explicit operator bool() const noexcept {
-        return fileGood;
-    }
+/**
+ * The columns used, all others are skipped when reading in ReadMode::Columnar.
+ */
+static constexpr std::array<EcoBeeDataFile::DataIndex,14> ProjectedData = {
+        EcoBeeDataFile::DataIndex::CurrentTemp,
+        EcoBeeDataFile::DataIndex::CurrentHumidity,
+        EcoBeeDataFile::DataIndex::Sensor0Temp,
+        EcoBeeDataFile::DataIndex::Sensor1Temp,
+        EcoBeeDataFile::DataIndex::Sensor2Temp,
+        EcoBeeDataFile::DataIndex::Sensor3Temp,
+        EcoBeeDataFile::DataIndex::ThermostatTemp,
+        EcoBeeDataFile::DataIndex::CoolSetTemp,
+        EcoBeeDataFile::DataIndex::HeatSetTemp,
+        EcoBeeDataFile::DataIndex::FanSec,
+        EcoBeeDataFile::DataIndex::HeatStage1Sec,
+        EcoBeeDataFile::DataIndex::CoolStage1Sec,
+        EcoBeeDataFile::DataIndex::DMOffset,
+        EcoBeeDataFile::DataIndex::OutdoorTemp,
+};
 
-    void processDataFile(const filesystem::path &file);
+/**
+ * The settings used to ingest report files.
+ */
+struct IngestConfig {
+    std::string influxHost{};
+    bool influxTLS{false};
+    long influxPort{8086};
+    std::string influxDb{};
+    InfluxBatch::Limits influxLimits{};
+    int influxGzipLevel{0};
+    ReadMode readMode{ReadMode::Load};
+    bool deleteProcessed{false};
+    unsigned int ingestThreads{1};
+    Spool *spool{nullptr};          ///< If set points are written to the spool, which is replayed to the database.
+    Rollup *rollup{nullptr};        ///< If set hourly and daily aggregates are accumulated and written.
+    std::filesystem::path rollupPath{}; ///< Where the rollup's open periods are saved with each checkpoint.
+};
 
-    static std::string escapeHeader(const std::string& hdr);
+/**
+ * @brief Record the progress through a file in the manifest.
+ * @details The rollup's open periods are saved first. Saved periods may hold rows after the checkpoint, when
+ * those rows are ingested again the rollup ignores them as already accumulated.
+ */
+static void checkpoint(Manifest &manifest, const IngestConfig &config, const std::filesystem::path &file,
+                       const Manifest::Entry &entry) {
+    if (config.rollup)
+        replaceFile(config.rollupPath, config.rollup->state());
+    manifest.checkpoint(file, entry);
+}
 
-    bool processHeader(const std::string& line);
 
-    bool processData(const std::string& line);
+/**
+ * @brief Ingest one report file.
+ * @details The time state data is carried from row to row within the file, so the rows of one file must be
+ * processed in order by one thread. Different files may be ingested at the same time. Rows already written
+ * according to the manifest entry are read only to carry the time state forward. Each time the batch is
+ * written the rows reached are checkpointed in the manifest.
+ * @param file The report file.
+ * @param influxPush The batch data is added to.
+ * @param config The ingest settings.
+ * @param progress True to output a per row progress indication.
+ * @param manifest The manifest of ingested files.
+ * @param resume The manifest entry to resume from.
+ * @return The manifest entry for all the rows of the file, which are written once influxPush is flushed.
+ */
+static Manifest::Entry ingestFile(const std::filesystem::path &file, InfluxBatch &influxPush,
+                                  const IngestConfig &config, bool progress, Manifest &manifest,
+                                  const Manifest::Entry &resume) {
+    SeriesKeys seriesKeys{"Home "};
+    EcoBeeDataFile ecoBeeData{};
+    auto timeStateData = TimeStateData;
+    auto reached = resume;
+    std::size_t row = 0;
+    auto batchCount = influxPush.batchCount();
+    std::deque<std::pair<std::size_t, Manifest::Entry>> queued{};  ///< The rows each queued batch ends at.
+
+    if (resume.rows)
+        std::cout << file.string() << ": resuming after row " << resume.rows << '\n';
 
-    bool processTimeState(InfluxPush &influxPush, EcoBeeDataFile::StateDataItem &stateDataItem,
-                          const DataLine &dataLine, const std::string &prefix) const;
+    /**
+     * Files may be ingested in any order, the first point of each state series in a file is always written.
+     */
+    influxPush.clearStates();
 
-    void processDMOffset(InfluxPush &influxPush, const EcoBeeDataFile::DataLine &dataLine,
-                                          const std::string &prefix) const;
+    /**
+     * Check if the current row was written by an earlier run.
+     */
+    auto written = [&]() {
+        return row < resume.rows && influxPush.getMeasurementEpoch() <= resume.epoch;
+    };
 
-    [[maybe_unused]] [[nodiscard]] size_t sensorCount() const {
-        if (fileGood) {
-            return (header.size() - Sensor0Temp) / 2;
+    /**
+     * Advance past the current row, checkpointing the rows of the last batch written since the last checkpoint.
+     * A batch may still be queued when the next rows are read, its rows are checkpointed once it is written.
+     */
+    auto nextRow = [&]() {
+        reached.rows = ++row;
+        reached.epoch = influxPush.getMeasurementEpoch();
+        if (influxPush.batchCount() != batchCount) {
+            batchCount = influxPush.batchCount();
+            queued.emplace_back(batchCount, reached);
         }
-        return 0;
-    }
-
-    [[maybe_unused]] [[nodiscard]] std::optional<const std::string> getHeader(DataIndex dataIndex) const {
-        auto idx = static_cast<size_t>(dataIndex);
-        if (fileGood && idx < header.size())
-            return header[idx];
-        return std::nullopt;
-    }
 
-    [[maybe_unused]] [[nodiscard]] std::optional<const std::string> getData(DataIndex dataIndex, const DataLine &dataLine) const {
-        auto idx = static_cast<size_t>(dataIndex);
-        if (fileGood && idx < header.size())
-            return dataLine[idx];
-        return std::nullopt;
-    }
+        std::optional<Manifest::Entry> last{};
+        for (; !queued.empty() && queued.front().first <= influxPush.requestCount(); queued.pop_front())
+            last = queued.front().second;
+        if (last)
+            checkpoint(manifest, config, file, last.value());
+    };
 
-    [[maybe_unused]] [[nodiscard]] auto begin() const {
-        return dataFile.cbegin();
-    }
+    /**
+     * Push one data row, line may be a DataLine or a DataView.
+     */
+    auto pushLine = [&](const auto &line) {
+        influxPush.newMeasurements();
+
+        /**
+         * Output a process indication.
+         */
+        if (progress) {
+            std::cout << ecoBeeData.getData(EcoBeeDataFile::DataIndex::Date, line).value()
+                      << ' '
+                      << ecoBeeData.getData(EcoBeeDataFile::DataIndex::Time, line).value()
+                      << '\r';
+            std::cout.flush();
+        }
 
-    [[maybe_unused]] [[nodiscard]] auto end() const {
-        return dataFile.cend();
-    }
-};
+        /**
+         * Set the measurement epoch.
+         */
+        influxPush.setMeasurementEpoch(ecoBeeData.getData(EcoBeeDataFile::DataIndex::Date, line).value(),
+                                       ecoBeeData.getData(EcoBeeDataFile::DataIndex::Time, line).value());
+        /**
+         * Rows already written carry the time state and the rollup forward, the measurements are discarded.
+         */
+        auto skip = written();
+
+        /**
+         * dataWritten will be used to detect when a other values are present.
+         * This will indicate that a default 0.0 value for DM Offset and the outside
+         * temperature should be written as well.
+         */
+        bool dataWritten = false;
+
+        /**
+         * Write the reported values list.
+         */
+        for (const auto dataIdx : ReportedData) {
+            if (auto name = ecoBeeData.getRawHeader(dataIdx); name)
+                dataWritten |= influxPush.addPoint(seriesKeys.key(name.value()), ecoBeeData.getData(dataIdx, line));
+        }
+        for (const auto dataIdx : SetPointData) {
+            auto name = ecoBeeData.getRawHeader(dataIdx);
+            if (auto value = ecoBeeData.getData(dataIdx, line); name && value)
+                dataWritten |= influxPush.addState(seriesKeys.key(name.value()), value.value());
+        }
 
-void EcoBeeDataFile::processDataFile(const filesystem::path &file) {
-    std::cout << file.string() << ": ";
-    std::ifstream strm(file.c_str());
-    if (strm) {
-        bool footPrintGood{false};
-        std::cout << "Open\n";
-        std::string line;
-        bool headerRead = false;
-        while (fileGood && std::getline(strm, line)) {
-            // Check the footprint.
-            if (!footPrintGood) {
-                if (line.length() > footPrint.size()) {
-                    auto lineItr = line.begin();
-                    for (const auto fpReq: footPrint) {
-                        if (fpReq != *lineItr++) {
-                            strm.close();
-                            return;
-                        }
-                    }
-                }
-                footPrintGood = true;
-                continue;
-            }
+        /**
+         * Write the time state data (heating, cooling, fan running)
+         */
+        for (auto &stateItem : timeStateData) {
+            dataWritten |= ecoBeeData.processTimeState(influxPush, stateItem, line, seriesKeys);
+        }
 
-            if (!line.empty()) {
-                auto c1 = line.at(0);
-                if (c1 != '#') {
-                    if (headerRead) {
-                        fileGood &= processData(line);
-                    } else {
-                        if (headerRead = fileGood = processHeader(line); !headerRead)
-                            return;
-                    }
+        /**
+         * If data has been written also write the DM Offset, writing a 0.0 value if none present,
+         * and the outside temperature. Then add all data to the batch for the server.
+         */
+        if (dataWritten) {
+            ecoBeeData.processDMOffset(influxPush, line, seriesKeys);
+            if (auto name = ecoBeeData.getRawHeader(EcoBeeDataFile::DataIndex::OutdoorTemp); name) {
+                const auto &seriesKey = seriesKeys.key(name.value());
+                auto value = ecoBeeData.getData(EcoBeeDataFile::DataIndex::OutdoorTemp, line);
+                influxPush.addPoint(seriesKey, value);
+                if (value) {
+                    std::string_view text{value.value()};
+                    double temperature{};
+                    if (std::from_chars(text.data(), text.data() + text.size(), temperature).ec == std::errc{})
+                        influxPush.addDegrees(seriesKey, ecoBee::FtoC(temperature));
                 }
             }
+            if (skip)
+                influxPush.discardData();
+            else
+                influxPush.pushData();
         }
-        strm.close();
-    } else {
-        std::cerr << strerror(errno) << '\n';
-    }
-}
-
-std::string EcoBeeDataFile::escapeHeader(const std::string& hdr) {
-    auto workingHdr = hdr;
-    if (auto pos = workingHdr.rfind(" ("); pos != std::string::npos) {
-        workingHdr = workingHdr.substr(0, pos);
-    }
+        if (skip)
+            ++row;
+        else
+            nextRow();
+    };
 
-    if (!workingHdr.empty())
-        for( auto pos = workingHdr.rfind(' '); pos > 0 && pos != std::string::npos; pos = workingHdr.rfind(' ', pos)) {
-            workingHdr.insert(pos, 1, '\\');
+    /**
+     * Push one data row from the typed columns, the same measurements as pushLine().
+     */
+    auto pushColumns = [&](const ColumnStore &columns, std::size_t index) {
+        influxPush.newMeasurements();
+        influxPush.setMeasurementEpoch(columns.epoch(index));
+        auto skip = written();
+
+        bool dataWritten = false;
+        for (const auto dataIdx : ReportedData) {
+            auto name = ecoBeeData.getRawHeader(dataIdx);
+            if (auto value = columns.number(dataIdx, index); name && value)
+                dataWritten |= influxPush.addPoint(seriesKeys.key(name.value()), value.value());
+        }
+        for (const auto dataIdx : SetPointData) {
+            auto name = ecoBeeData.getRawHeader(dataIdx);
+            if (auto value = columns.number(dataIdx, index); name && value)
+                dataWritten |= influxPush.addState(seriesKeys.key(name.value()), value.value());
         }
 
-    return workingHdr;
-}
+        for (auto &stateItem : timeStateData) {
+            if (columns.present(stateItem.dataIndex, index))
+                dataWritten |= ecoBeeData.writeTimeState(influxPush, stateItem,
+                                                         columns.seconds(stateItem.dataIndex, index), seriesKeys);
+        }
 
-bool EcoBeeDataFile::processHeader(const std::string& line) {
-    for ( std::string::size_type start = 0, pos; start < line.length(); start = pos + 1) {
-        pos = line.find(',', start);
-        if (pos == std::string::npos) {
-            header.push_back(escapeHeader(line.substr(start)));
-            return true;
-        } else {
-            header.push_back(escapeHeader(line.substr(start, pos - start)));
+        if (dataWritten) {
+            if (auto name = ecoBeeData.getRawHeader(EcoBeeDataFile::DataIndex::DMOffset); name)
+                influxPush.addState(seriesKeys.key(name.value()),
+                                    columns.number(EcoBeeDataFile::DataIndex::DMOffset, index).value_or(0.f));
+            auto name = ecoBeeData.getRawHeader(EcoBeeDataFile::DataIndex::OutdoorTemp);
+            if (auto value = columns.number(EcoBeeDataFile::DataIndex::OutdoorTemp, index); name && value) {
+                influxPush.addPoint(seriesKeys.key(name.value()), value.value());
+                influxPush.addDegrees(seriesKeys.key(name.value()), ecoBee::FtoC(value.value()));
+            }
+            if (skip)
+                influxPush.discardData();
+            else
+                influxPush.pushData();
         }
+        if (skip)
+            ++row;
+        else
+            nextRow();
+    };
+
+    if (config.readMode == ReadMode::Columnar) {
+        ecoBeeData.loadColumns(file, ProjectedData);
+        const auto &columns = ecoBeeData.columns();
+        for (std::size_t index = 0; index < columns.size(); ++index)
+            pushColumns(columns, index);
+    } else if (config.readMode == ReadMode::Stream) {
+        ecoBeeData.streamDataFile(file, pushLine);
+    } else if (config.readMode == ReadMode::Map) {
+        ecoBeeData.mapDataFile(file);
+        for (const auto &line : ecoBeeData.mappedRows())
+            pushLine(line);
+    } else {
+        ecoBeeData.processDataFile(file);
+        for (const auto &line : ecoBeeData)
+            pushLine(line);
     }
-    return false;
+
+    if (progress)
+        std::cout << '\n';
+    return reached;
 }
 
-bool EcoBeeDataFile::processData(const string &line) {
-    DataLine data;
-    for ( std::string::size_type start = 0, pos; start < line.length(); start = pos + 1) {
-        pos = line.find(',', start);
-        if (pos == std::string::npos) {
-            data.push_back(line.substr(start));
-            break;
-        } else {
-            data.push_back(line.substr(start, pos - start));
-        }
-    }
-    if (data.size() == header.size()) {
-        dataFile.push_back(data);
-        return true;
-    }
-    return false;
+static bool isDataFile(const std::filesystem::path &file, const std::string &dataPrefix) {
+    return file.filename().string().rfind(dataPrefix, 0) == 0;
 }
 
-void EcoBeeDataFile::processDMOffset(InfluxPush &influxPush, const EcoBeeDataFile::DataLine &dataLine,
-                                     const std::string &prefix) const {
-    if (auto name = getHeader(DataIndex::DMOffset); name.has_value()) {
-        if (auto dmOffset = getData(DataIndex::DMOffset, dataLine);
-                dmOffset.has_value() && !dmOffset.value().empty()) {
-            influxPush.addMeasurement(prefix, name, dmOffset);
-        } else {
-            influxPush.addMeasurement(prefix, name, std::optional<std::string>("0.0"));
+/**
+ * @brief Ingest report files on a pool of worker threads.
+ * @details Each worker takes the next file and ingests it from start to finish, so the rows of a file are
+ * always processed in order. Each worker has one InfluxBatch for all the files it processes, its batches are
+ * written by one writer thread shared by the workers so parsing continues while they are written. Files the
+ * manifest records as completely ingested and unchanged are skipped. A rollup needs the rows of every series
+ * in date order, with one the files are ingested by a single worker.
+ * @param dataFiles The files, they are ingested in name order which is date order for ecoBee exports.
+ * @param config The ingest settings.
+ * @param manifest The manifest of ingested files.
+ * @throws The first exception thrown by a worker, files not yet started are then not ingested.
+ */
+static void ingestFiles(std::vector<std::filesystem::path> dataFiles, const IngestConfig &config,
+                        Manifest &manifest) {
+    std::ranges::sort(dataFiles);
+
+    auto threadCount = std::min<std::size_t>(config.rollup ? 1 : config.ingestThreads, dataFiles.size());
+    std::atomic<std::size_t> nextFile{0};
+    std::atomic<bool> failed{false};
+    std::mutex failureMutex{};
+    std::exception_ptr failure{};
+    {
+        AsyncWriter writer{config.spool ? config.spool->transport() :
+                           InfluxBatch::httpTransport(config.influxHost, config.influxTLS, config.influxPort,
+                                                      config.influxDb, config.influxGzipLevel)};
+        std::vector<std::jthread> workers{};
+        for (std::size_t worker = 0; worker < threadCount; ++worker) {
+            workers.emplace_back([&]() {
+                try {
+                    InfluxBatch influxPush(writer, config.influxLimits);
+                    influxPush.setRollup(config.rollup);
+                    for (std::size_t idx; !failed && (idx = nextFile++) < dataFiles.size();) {
+                        if (auto resume = manifest.resume(dataFiles[idx]); !resume.complete) {
+                            auto reached = ingestFile(dataFiles[idx], influxPush, config, threadCount == 1,
+                                                      manifest, resume);
+
+                            /**
+                             * Write the rest of the batch to the spool and wait for the writer, a failure
+                             * throws before the file is recorded as complete or deleted.
+                             */
+                            influxPush.flush();
+                            reached.complete = true;
+                            checkpoint(manifest, config, dataFiles[idx], reached);
+                        }
+
+                        /**
+                         * Action the delete processed files flag if set.
+                         */
+                        if (config.deleteProcessed) {
+                            std::error_code ec;
+                            auto res = std::filesystem::remove(dataFiles[idx], ec);
+                            if (!res) {
+                                std::cerr << ec << '\n';
+                            } else {
+                                manifest.erase(dataFiles[idx]);
+                            }
+                        }
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock{failureMutex};
+                    if (!failure)
+                        failure = std::current_exception();
+                    failed = true;
+                }
+            });
         }
-    } else {
-        std::cerr << "No name\n";
     }
+
+    if (failure)
+        std::rethrow_exception(failure);
 }
 
-bool EcoBeeDataFile::processTimeState(InfluxPush &influxPush, EcoBeeDataFile::StateDataItem &stateDataItem,
-                                      const DataLine &dataLine, const std::string &prefix) const {
-    const static std::optional<std::string>True{"true"};
-    const static std::optional<std::string>False{"false"};
+/**
+ * @brief Stay resident and ingest each report file as soon as it has been completely written to the data path.
+ * @details Files written in place are seen when they are closed (IN_CLOSE_WRITE), files moved into the data
+ * path when the move completes (IN_MOVED_TO). Files that fail to ingest are retried every RetrySeconds.
+ * The watch is established before the existing files are ingested so none are missed. If the event queue
+ * overflows the data path is scanned again, files already ingested are skipped by the manifest.
+ * @param dataPath The directory to watch.
+ * @param dataPrefix The report file name prefix.
+ * @param config The ingest settings.
+ * @param manifest The manifest of ingested files.
+ * @return 1 if the watch can not be established or read, otherwise does not return.
+ */
+static int watchDataPath(const std::filesystem::path &dataPath, const std::string &dataPrefix,
+                         const IngestConfig &config, Manifest &manifest) {
+    static constexpr int RetrySeconds = 60;
 
-    bool dataWritten{false};
-    try {
-        auto timeStamp = influxPush.getMeasurementEpoch();
-        if (auto valueString = getData(stateDataItem.dataIndex, dataLine);
-                valueString.has_value() && !valueString.value().empty()) {
-            if (auto value = ConfigFile::safeConvert<unsigned long>(valueString.value()); value) {
-                if (value.value() == 0 || value.value() == MaximumTimeValue) {
-                    if (value.value() == 0 && stateDataItem.state) {
-                        stateDataItem.state = false;
-                    } else if (value.value() == MaximumTimeValue && !stateDataItem.state) {
-                        stateDataItem.state = true;
-                    }
-                } else {
-                    if (stateDataItem.state) {
-                        timeStamp += value.value() * 1000000000;
-                        stateDataItem.state = false;
-                    } else {
-                        timeStamp += (MaximumTimeValue - value.value()) * 1000000000;
-                        stateDataItem.state = true;
-                    }
-                }
+    auto fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dataPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << dataPath.string() << ": " << strerror(errno) << '\n';
+        return 1;
+    }
+
+    std::set<std::filesystem::path> pending{};
+    auto scanDataPath = [&]() {
+        for (const auto &dir_entry : std::filesystem::directory_iterator{dataPath}) {
+            if (dir_entry.is_regular_file() && isDataFile(dir_entry.path(), dataPrefix))
+                pending.insert(dir_entry.path());
+        }
+    };
+    scanDataPath();
+
+    alignas(struct inotify_event) char buffer[4096];
+    while (true) {
+        if (!pending.empty()) {
+            std::vector<std::filesystem::path> dataFiles{};
+            for (const auto &file : pending) {
+                if (std::filesystem::is_regular_file(file))
+                    dataFiles.push_back(file);
             }
-            if (auto headerString = getHeader(stateDataItem.dataIndex); headerString.has_value()) {
-                influxPush.addMeasurement(prefix, headerString,
-                                          (stateDataItem.state ? True : False), timeStamp);
-                dataWritten = true;
+            try {
+                ingestFiles(dataFiles, config, manifest);
+                pending.clear();
+            } catch (std::exception &e) {
+                std::cerr << e.what() << '\n';
+                std::erase_if(pending, [](const auto &file) { return !std::filesystem::exists(file); });
             }
         }
 
-        return dataWritten;
-    } catch (exception& e) {
-        std::cerr << e.what();
-        throw e;
+        pollfd pollFd{fd, POLLIN, 0};
+        if (poll(&pollFd, 1, pending.empty() ? -1 : RetrySeconds * 1000) <= 0)
+            continue;
+
+        auto length = read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << dataPath.string() << ": " << strerror(errno) << '\n';
+            return 1;
+        }
+        for (auto ptr = buffer; ptr < buffer + length;) {
+            auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+            if (event->mask & IN_Q_OVERFLOW)
+                scanDataPath();     // Events were dropped, the files they named are found by a scan.
+            else if (event->len > 0 && isDataFile(event->name, dataPrefix))
+                pending.insert(dataPath / event->name);
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
     }
 }
 
 int main(int argc, char **argv) {
     static constexpr std::string_view ConfigOption = "--config";
+    static constexpr std::string_view WatchOption = "--watch";
     std::optional<bool> influxTLS{false};
     std::optional<bool> deleteProcessed{false};
     std::optional<std::string> influxHost{"influx"};
     std::optional<std::string> influxDb{"ecoBee"};
     std::optional<long> influxPort{8086};
-
-    std::array<EcoBeeDataFile::DataIndex,9> reportedData = {
-            EcoBeeDataFile::DataIndex::CurrentTemp,
-            EcoBeeDataFile::DataIndex::CurrentHumidity,
-            EcoBeeDataFile::DataIndex::Sensor0Temp,
-            EcoBeeDataFile::DataIndex::Sensor1Temp,
-            EcoBeeDataFile::DataIndex::Sensor2Temp,
-            EcoBeeDataFile::DataIndex::Sensor3Temp,
-            EcoBeeDataFile::DataIndex::ThermostatTemp,
-            EcoBeeDataFile::DataIndex::CoolSetTemp,
-            EcoBeeDataFile::DataIndex::HeatSetTemp,
-    };
-
-    std::array<EcoBeeDataFile::StateDataItem,3> timeStateData = {{
-                                                     {EcoBeeDataFile::DataIndex::FanSec, false },
-                                                     {EcoBeeDataFile::DataIndex::HeatStage1Sec, false },
-                                                     {EcoBeeDataFile::DataIndex::CoolStage1Sec, false },
-                                             }};
+    InfluxBatch::Limits influxLimits{};
+    int influxGzipLevel{0};
+    std::optional<bool> rollups{false};
+    double rollupBaseTemperature{Rollup::DefaultBaseTemperature};
+    ReadMode readMode{ReadMode::Load};
+    unsigned int ingestThreads{std::max(std::thread::hardware_concurrency(), 1u)};
 
     enum class ConfigItem {
         DataPrefix,
@@ -294,6 +498,18 @@ int main(int argc, char **argv) {
         InfluxPort,
         InfluxDb,
         DeleteProcessed,
+        ReadMode,
+        InfluxBatchPoints,
+        InfluxBatchBytes,
+        InfluxBatchSeconds,
+        IngestThreads,
+        ManifestPath,
+        ValuePrecision,
+        SpoolPath,
+        InfluxGzipLevel,
+        StateKeyframeMinutes,
+        Rollups,
+        RollupBaseTemperature,
     };
 
     std::vector<ConfigFile::Spec> ConfigSpec
@@ -305,10 +521,24 @@ int main(int argc, char **argv) {
                      {"influxPort", ConfigItem::InfluxPort},
                      {"influxDb", ConfigItem::InfluxDb},
                      {"deleteProcessed", ConfigItem::DeleteProcessed},
+                     {"readMode", ConfigItem::ReadMode},
+                     {"influxBatchPoints", ConfigItem::InfluxBatchPoints},
+                     {"influxBatchBytes", ConfigItem::InfluxBatchBytes},
+                     {"influxBatchSeconds", ConfigItem::InfluxBatchSeconds},
+                     {"ingestThreads", ConfigItem::IngestThreads},
+                     {"manifestPath", ConfigItem::ManifestPath},
+                     {"valuePrecision", ConfigItem::ValuePrecision},
+                     {"spoolPath", ConfigItem::SpoolPath},
+                     {"influxGzipLevel", ConfigItem::InfluxGzipLevel},
+                     {"stateKeyframeMinutes", ConfigItem::StateKeyframeMinutes},
+                     {"rollups", ConfigItem::Rollups},
+                     {"rollupBaseTemperature", ConfigItem::RollupBaseTemperature},
              }};
 
     std::optional<std::filesystem::path> dataPath{};
     std::optional<std::string> dataPrefix{};
+    std::optional<std::filesystem::path> manifestPath{};
+    std::optional<std::filesystem::path> spoolPath{};
 
     try {
         xdg::Environment &environment{xdg::Environment::getEnvironment(false)};
@@ -371,6 +601,86 @@ int main(int argc, char **argv) {
                         });
                         validValue = influxDb.has_value();
                         break;
+                    case ConfigItem::ReadMode:
+                        if (auto mode = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c);
+                        }); mode.has_value()) {
+                            if (mode.value() == "Load") {
+                                readMode = ReadMode::Load;
+                                validValue = true;
+                            } else if (mode.value() == "Map") {
+                                readMode = ReadMode::Map;
+                                validValue = true;
+                            } else if (mode.value() == "Stream") {
+                                readMode = ReadMode::Stream;
+                                validValue = true;
+                            } else if (mode.value() == "Columnar") {
+                                readMode = ReadMode::Columnar;
+                                validValue = true;
+                            }
+                        }
+                        break;
+                    case ConfigItem::InfluxBatchPoints:
+                        if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() > 0) {
+                            influxLimits.maxPoints = static_cast<std::size_t>(value.value());
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::InfluxBatchBytes:
+                        if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() > 0) {
+                            influxLimits.maxBytes = static_cast<std::size_t>(value.value());
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::InfluxBatchSeconds:
+                        if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() >= 0) {
+                            influxLimits.maxAge = std::chrono::seconds{value.value()};
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::InfluxGzipLevel:
+                        if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() &&
+                                value.value() >= 0 && value.value() <= ecoBee::GzipEncoder::MaximumLevel) {
+                            influxGzipLevel = static_cast<int>(value.value());
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::StateKeyframeMinutes:
+                        if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() >= 0) {
+                            influxLimits.stateKeyframe = std::chrono::minutes{value.value()};
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::Rollups:
+                        rollups = ConfigFile::parseBoolean(data);
+                        validValue = rollups.has_value();
+                        break;
+                    case ConfigItem::RollupBaseTemperature:
+                        validValue = std::from_chars(data.data(), data.data() + data.size(),
+                                                     rollupBaseTemperature).ec == std::errc{};
+                        break;
+                    case ConfigItem::IngestThreads:
+                        if (auto value = ConfigFile::safeConvert<long>(data); value.has_value() && value.value() >= 0) {
+                            if (value.value() > 0)
+                                ingestThreads = static_cast<unsigned int>(value.value());
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::ValuePrecision:
+                        if (auto value = ConfigFile::safeConvert<long>(data);
+                                value.has_value() && value.value() >= -1 && value.value() <= 9) {
+                            influxLimits.precision = static_cast<int>(value.value());
+                            validValue = true;
+                        }
+                        break;
+                    case ConfigItem::ManifestPath:
+                        manifestPath = ConfigFile::parseFilesystemPath(data);
+                        validValue = manifestPath.has_value();
+                        break;
+                    case ConfigItem::SpoolPath:
+                        spoolPath = ConfigFile::parseFilesystemPath(data);
+                        validValue = spoolPath.has_value();
+                        break;
                     default:
                         break;
                 }
@@ -381,83 +691,44 @@ int main(int argc, char **argv) {
             });
             configFile.close();
 
-            const std::string prefix{"Home "};
             if (validFile && dataPath.has_value() && dataPrefix.has_value()) {
-                std::ranges::for_each(std::filesystem::directory_iterator{dataPath.value()},
-                                      [&](const auto &dir_entry) {
-                                          EcoBeeDataFile ecoBeeData{};
-                                          InfluxPush influxPush(influxHost.value(), influxTLS.value(), influxPort.value(), influxDb.value());
-                                          if (dir_entry.is_regular_file() &&
-                                              dir_entry.path().filename().string().rfind(dataPrefix.value(), 0) == 0) {
-                                              ecoBeeData.processDataFile(dir_entry);
-                                              for (const auto &line : ecoBeeData) {
-                                                  influxPush.newMeasurements();
-
-                                                  /**
-                                                   * Output a process indication.
-                                                   */
-                                                  std::cout << ecoBeeData.getData(EcoBeeDataFile::DataIndex::Date, line).value()
-                                                            << ' '
-                                                            << ecoBeeData.getData(EcoBeeDataFile::DataIndex::Time, line).value()
-                                                            << '\r';
-                                                  std::cout.flush();
-
-                                                  /**
-                                                   * Set the measurement epoch.
-                                                   */
-                                                  influxPush.setMeasurementEpoch(
-                                                          ecoBeeData.getData(EcoBeeDataFile::DataIndex::Date,
-                                                                             line).value(),
-                                                          ecoBeeData.getData(EcoBeeDataFile::DataIndex::Time,
-                                                                             line).value());
-                                                  /**
-                                                   * dataWritten will be used to detect when a other values are present.
-                                                   * This will indicate that a default 0.0 value for DM Offset and the outside
-                                                   * temperature should be written as well.
-                                                   */
-                                                  bool dataWritten = false;
-
-                                                  /**
-                                                   * Write the reported values list.
-                                                   */
-                                                  for (const auto dataIdx : reportedData) {
-                                                      dataWritten |= influxPush.addMeasurement(prefix,ecoBeeData.getHeader(dataIdx),
-                                                                                ecoBeeData.getData(dataIdx, line));
-                                                  }
-
-                                                  /**
-                                                   * Write the time state data (heating, cooling, fan running)
-                                                   */
-                                                  for (auto &stateItem : timeStateData) {
-                                                      dataWritten |= ecoBeeData.processTimeState(influxPush, stateItem, line,
-                                                                                  prefix);
-                                                  }
-
-                                                  /**
-                                                   * If data has been written also write the DM Offset, writing a 0.0 value if none present,
-                                                   * and the outside temperature. Then push all data to the server.
-                                                   */
-                                                  if (dataWritten) {
-                                                      ecoBeeData.processDMOffset(influxPush, line, prefix);
-                                                      influxPush.addMeasurement(prefix, ecoBeeData.getHeader(EcoBeeDataFile::DataIndex::OutdoorTemp),
-                                                                                ecoBeeData.getData(EcoBeeDataFile::DataIndex::OutdoorTemp, line));
-                                                      influxPush.pushData();
-                                                  }
-                                              }
-                                              std::cout << '\n';
-
-                                              /**
-                                               * Action the delete processed files flag if set.
-                                               */
-                                              if (deleteProcessed.has_value() && deleteProcessed.value()) {
-                                                  std::error_code ec;
-                                                  auto res = std::filesystem::remove(dir_entry, ec);
-                                                  if (!res) {
-                                                      std::cerr << ec << '\n';
-                                                  }
-                                              }
-                                          }
-                                      });
+                IngestConfig ingestConfig{influxHost.value(), influxTLS.value(), influxPort.value(), influxDb.value(),
+                                          influxLimits, influxGzipLevel, readMode, deleteProcessed.value_or(false),
+                                          ingestThreads};
+
+                auto manifestFile = manifestPath.value_or(environment.get_configuration_paths("manifest.txt").front());
+                Manifest manifest{manifestFile};
+
+                // Files are recorded as ingested and deleted once their points are synced to the spool.
+                Spool spool{spoolPath.value_or(environment.get_configuration_paths("spool").front())};
+                SpoolReplayer replayer{spool, InfluxBatch::httpTransport(ingestConfig.influxHost,
+                                                                         ingestConfig.influxTLS,
+                                                                         ingestConfig.influxPort,
+                                                                         ingestConfig.influxDb,
+                                                                         ingestConfig.influxGzipLevel),
+                                       std::max(influxLimits.maxAge, std::chrono::seconds{1})};
+                ingestConfig.spool = &spool;
+
+                // Open periods carry from one file to the next, and in watch mode from one batch of files to the next.
+                // They are saved beside the manifest so a period split between report files combines across runs.
+                Rollup rollup{rollupBaseTemperature};
+                if (rollups.value_or(false)) {
+                    ingestConfig.rollup = &rollup;
+                    ingestConfig.rollupPath = std::filesystem::path{manifestFile}.replace_extension(".rollup");
+                    if (std::ifstream strm{ingestConfig.rollupPath}; strm)
+                        rollup.restore(std::string{std::istreambuf_iterator<char>{strm},
+                                                   std::istreambuf_iterator<char>{}});
+                }
+
+                if (inputParser.cmdOptionExists(WatchOption))
+                    return watchDataPath(dataPath.value(), dataPrefix.value(), ingestConfig, manifest);
+
+                std::vector<std::filesystem::path> dataFiles{};
+                for (const auto &dir_entry : std::filesystem::directory_iterator{dataPath.value()}) {
+                    if (dir_entry.is_regular_file() && isDataFile(dir_entry.path(), dataPrefix.value()))
+                        dataFiles.push_back(dir_entry.path());
+                }
+                ingestFiles(dataFiles, ingestConfig, manifest);
             }
         } else {
             return 1;
@@ -0,0 +1,44 @@
+/**
+ * @file AtomicFile.cpp
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "AtomicFile.h"
+
+void replaceFile(const std::filesystem::path &path, std::string_view text) {
+    auto temporary = path;
+    temporary += ".tmp";
+    auto fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw AtomicFileError(temporary.string() + ": " + strerror(errno));
+
+    for (auto data = text; !data.empty();) {
+        auto count = ::write(fd, data.data(), data.size());
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0) {
+            std::string error{strerror(errno)};
+            ::close(fd);
+            throw AtomicFileError(temporary.string() + " write: " + error);
+        }
+        data.remove_prefix(static_cast<std::size_t>(count));
+    }
+    if (::fsync(fd) < 0) {
+        std::string error{strerror(errno)};
+        ::close(fd);
+        throw AtomicFileError(temporary.string() + " fsync: " + error);
+    }
+    ::close(fd);
+
+    if (::rename(temporary.c_str(), path.c_str()) < 0)
+        throw AtomicFileError(path.string() + ": " + strerror(errno));
+
+    auto directory = path.parent_path().empty() ? std::filesystem::path{"."} : path.parent_path();
+    if (auto dir = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+}
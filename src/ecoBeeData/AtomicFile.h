@@ -0,0 +1,29 @@
+/**
+ * @file AtomicFile.h
+ * @brief Replace a small record file so a crash leaves either the old or the new content.
+ * @details The content is written to a temporary file beside the record, synced, renamed over the record and
+ * the directory is synced so the rename itself survives a crash.
+ */
+
+#ifndef ECOBEEDATA_ATOMICFILE_H
+#define ECOBEEDATA_ATOMICFILE_H
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+class AtomicFileError : public std::runtime_error {
+public:
+    explicit AtomicFileError(const std::string& what_arg) : std::runtime_error(what_arg) {}
+};
+
+/**
+ * @brief Replace the content of a file atomically and durably.
+ * @param path The file, its directory must exist.
+ * @param text The new content.
+ * @throws AtomicFileError if the file can not be written, the old content is left in place.
+ */
+void replaceFile(const std::filesystem::path &path, std::string_view text);
+
+#endif //ECOBEEDATA_ATOMICFILE_H
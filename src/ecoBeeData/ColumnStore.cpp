@@ -0,0 +1,155 @@
+/**
+ * @file ColumnStore.cpp
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "ColumnStore.h"
+
+void ColumnStore::project(std::size_t columnCount, std::size_t dateColumn, std::size_t timeColumn,
+                          std::span<const Projection> projection) {
+    mDateColumn = dateColumn;
+    mTimeColumn = timeColumn;
+    mColumns.clear();
+    mColumns.resize(columnCount);
+    mEpochs.clear();
+    for (const auto &item : projection) {
+        if (item.column < columnCount) {
+            mColumns[item.column].type = item.type;
+            if (item.type == ColumnType::Dictionary)
+                mColumns[item.column].dictionary.emplace_back();
+        }
+    }
+}
+
+void ColumnStore::reserve(std::size_t rows) {
+    mEpochs.reserve(rows);
+    for (auto &column : mColumns) {
+        switch (column.type) {
+            case ColumnType::Number:
+                column.numbers.reserve(rows);
+                break;
+            case ColumnType::Seconds:
+                column.seconds.reserve(rows);
+                break;
+            case ColumnType::Dictionary:
+                column.codes.reserve(rows);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+ColumnStore::Epoch ColumnStore::epochOf(std::string_view date, std::string_view time) {
+    // Convert each hour once, the minutes and seconds are added to the start of the hour.
+    auto hour = time.substr(0, time.find(':'));
+    if (mHourKey.size() != date.size() + hour.size() ||
+            std::string_view{mHourKey}.substr(0, date.size()) != date ||
+            std::string_view{mHourKey}.substr(date.size()) != hour) {
+        mHourKey.assign(date).append(hour);
+        mHourEpoch = InfluxBatch::localEpoch(date, std::string{hour}.append(":00:00"));
+    }
+
+    unsigned long minutes{0}, seconds{0};
+    if (auto pos = time.find(':'); pos != std::string_view::npos) {
+        auto rest = time.substr(pos + 1);
+        auto result = std::from_chars(rest.data(), rest.data() + rest.size(), minutes);
+        if (result.ptr != rest.data() + rest.size() && *result.ptr == ':')
+            std::from_chars(result.ptr + 1, rest.data() + rest.size(), seconds);
+    }
+    return mHourEpoch + (minutes * 60 + seconds) * 1000000000ULL;
+}
+
+uint8_t ColumnStore::encode(Column &column, std::string_view value) {
+    if (value.empty())
+        return 0;
+    for (std::size_t code = 1; code < column.dictionary.size(); ++code) {
+        if (column.dictionary[code] == value)
+            return static_cast<uint8_t>(code);
+    }
+    if (column.dictionary.size() > std::numeric_limits<uint8_t>::max())
+        throw std::runtime_error("Too many distinct values in a dictionary column.");
+    column.dictionary.emplace_back(value);
+    return static_cast<uint8_t>(column.dictionary.size() - 1);
+}
+
+bool ColumnStore::append(std::span<const std::string_view> fields) {
+    if (fields.size() != mColumns.size() || mDateColumn >= fields.size() || mTimeColumn >= fields.size())
+        return false;
+
+    mEpochs.push_back(epochOf(fields[mDateColumn], fields[mTimeColumn]));
+    for (std::size_t idx = 0; idx < mColumns.size(); ++idx) {
+        auto &column = mColumns[idx];
+        auto field = fields[idx];
+        switch (column.type) {
+            case ColumnType::Number: {
+                // A field with anything after the number is not a number, as "78.5F" is not 78.5.
+                float value{std::numeric_limits<float>::quiet_NaN()};
+                if (auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+                        result.ec != std::errc{} || result.ptr != field.data() + field.size())
+                    value = std::numeric_limits<float>::quiet_NaN();
+                column.numbers.push_back(value);
+            }
+                break;
+            case ColumnType::Seconds: {
+                // Converted as the text readers convert them, a field that does not convert is still present.
+                uint32_t value{EmptySeconds};
+                if (!field.empty() && (std::from_chars(field.data(), field.data() + field.size(), value).ec !=
+                        std::errc{} || value == EmptySeconds))
+                    value = InvalidSeconds;
+                column.seconds.push_back(value);
+            }
+                break;
+            case ColumnType::Dictionary:
+                column.codes.push_back(encode(column, field));
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+std::optional<float> ColumnStore::number(std::size_t column, std::size_t row) const {
+    if (column < mColumns.size() && mColumns[column].type == ColumnType::Number) {
+        if (auto value = mColumns[column].numbers[row]; !std::isnan(value))
+            return value;
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned long> ColumnStore::seconds(std::size_t column, std::size_t row) const {
+    if (column < mColumns.size() && mColumns[column].type == ColumnType::Seconds) {
+        if (auto value = mColumns[column].seconds[row]; value != EmptySeconds && value != InvalidSeconds)
+            return value;
+    }
+    return std::nullopt;
+}
+
+bool ColumnStore::present(std::size_t column, std::size_t row) const {
+    if (column >= mColumns.size())
+        return false;
+    const auto &stored = mColumns[column];
+    switch (stored.type) {
+        case ColumnType::Number:
+            return !std::isnan(stored.numbers[row]);
+        case ColumnType::Seconds:
+            return stored.seconds[row] != EmptySeconds;
+        case ColumnType::Dictionary:
+            return stored.codes[row] != 0;
+        default:
+            return false;
+    }
+}
+
+std::optional<std::string_view> ColumnStore::text(std::size_t column, std::size_t row) const {
+    if (column < mColumns.size() && mColumns[column].type == ColumnType::Dictionary) {
+        if (auto code = mColumns[column].codes[row]; code != 0)
+            return mColumns[column].dictionary[code];
+    }
+    return std::nullopt;
+}
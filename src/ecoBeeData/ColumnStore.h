@@ -0,0 +1,109 @@
+/**
+ * @file ColumnStore.h
+ * @brief Typed, column oriented storage for the rows of a data file.
+ * @details Each projected column is converted once when the row is added: numbers to float, run times in
+ * seconds to 32 bit unsigned and modes to a one byte code into a per column dictionary. The date and time columns are
+ * combined into a single epoch column. Columns that are not projected are not converted or stored.
+ */
+
+#ifndef ECOBEEDATA_COLUMNSTORE_H
+#define ECOBEEDATA_COLUMNSTORE_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "InfluxBatch.h"
+
+/**
+ * @class ColumnStore
+ */
+class ColumnStore {
+public:
+    using Epoch = InfluxBatch::Epoch;
+
+    enum class ColumnType {
+        Skipped,        ///< Not stored.
+        Number,         ///< Stored as float, NaN if empty or not entirely a number.
+        Seconds,        ///< Stored as uint32_t, EmptySeconds if empty, InvalidSeconds if not a number.
+        Dictionary,     ///< Stored as a code into the column dictionary, 0 if empty.
+    };
+
+    struct Projection {
+        std::size_t column;
+        ColumnType type;
+    };
+
+private:
+    static constexpr uint32_t EmptySeconds = ~uint32_t{0};
+    static constexpr uint32_t InvalidSeconds = EmptySeconds - 1;
+
+    struct Column {
+        ColumnType type{ColumnType::Skipped};
+        std::vector<float> numbers{};
+        std::vector<uint32_t> seconds{};
+        std::vector<uint8_t> codes{};
+        std::vector<std::string> dictionary{};  ///< Code 0 is the empty string.
+    };
+
+    std::size_t mDateColumn{0}, mTimeColumn{1};
+    std::vector<Column> mColumns{};
+    std::vector<Epoch> mEpochs{};
+
+    // The epoch of the start of the last hour converted, DST can only change on an hour boundary.
+    std::string mHourKey{};
+    Epoch mHourEpoch{0};
+
+    Epoch epochOf(std::string_view date, std::string_view time);
+
+    static uint8_t encode(Column &column, std::string_view value);
+
+public:
+    ColumnStore() = default;
+
+    /**
+     * @brief Select the columns to store, clearing any stored rows.
+     * @param columnCount The number of columns in each row.
+     * @param dateColumn The index of the local date column.
+     * @param timeColumn The index of the local time column.
+     * @param projection The columns to store and their types.
+     */
+    void project(std::size_t columnCount, std::size_t dateColumn, std::size_t timeColumn,
+                 std::span<const Projection> projection);
+
+    void reserve(std::size_t rows);
+
+    /**
+     * @brief Convert and store the projected fields of a row.
+     * @param fields All fields of the row.
+     * @return False if the row does not have the projected number of columns.
+     */
+    bool append(std::span<const std::string_view> fields);
+
+    [[nodiscard]] std::size_t size() const {
+        return mEpochs.size();
+    }
+
+    [[nodiscard]] Epoch epoch(std::size_t row) const {
+        return mEpochs[row];
+    }
+
+    [[nodiscard]] std::optional<float> number(std::size_t column, std::size_t row) const;
+
+    /**
+     * @return The seconds, std::nullopt if the field is empty or not a number.
+     */
+    [[nodiscard]] std::optional<unsigned long> seconds(std::size_t column, std::size_t row) const;
+
+    /**
+     * @brief True if a field of a stored column holds a value. A run time that is not a number holds one, as it
+     * does for the text readers, a number that did not convert does not.
+     */
+    [[nodiscard]] bool present(std::size_t column, std::size_t row) const;
+
+    [[nodiscard]] std::optional<std::string_view> text(std::size_t column, std::size_t row) const;
+};
+
+#endif //ECOBEEDATA_COLUMNSTORE_H
@@ -0,0 +1,248 @@
+//
+// Created by richard on 2022-12-27.
+//
+
+/*
+ * EcoBeeDataFile.cpp Created by Richard Buckley (C) 2022-12-27
+ */
+
+/**
+ * @file EcoBeeDataFile.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2022-12-27
+ */
+
+#include <cstring>
+#include <fstream>
+#include "EcoBeeDataFile.h"
+
+bool EcoBeeDataFile::checkFootPrint(std::string_view line) const {
+    if (line.length() > footPrint.size()) {
+        auto lineItr = line.begin();
+        for (const auto fpReq: footPrint) {
+            if (fpReq != *lineItr++) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void EcoBeeDataFile::processDataFile(const std::filesystem::path &file) {
+    std::cout << file.string() << ": ";
+    std::ifstream strm(file.c_str());
+    if (strm) {
+        bool footPrintGood{false};
+        std::cout << "Open\n";
+        std::string line;
+        bool headerRead = false;
+        while (fileGood && std::getline(strm, line)) {
+            // Check the footprint.
+            if (!footPrintGood) {
+                if (!checkFootPrint(line)) {
+                    strm.close();
+                    return;
+                }
+                footPrintGood = true;
+                continue;
+            }
+
+            if (!line.empty()) {
+                auto c1 = line.at(0);
+                if (c1 != '#') {
+                    if (headerRead) {
+                        fileGood &= processData(line);
+                    } else {
+                        if (headerRead = fileGood = processHeader(line); !headerRead)
+                            return;
+                    }
+                }
+            }
+        }
+        strm.close();
+    } else {
+        std::cerr << strerror(errno) << '\n';
+    }
+}
+
+void EcoBeeDataFile::scanMappedFile(const std::filesystem::path &file,
+                                    const std::function<bool(std::string_view, const DataView &)> &lineFunction) {
+    std::cout << file.string() << ": ";
+    if (!mappedFile.map(file)) {
+        std::cerr << strerror(errno) << '\n';
+        return;
+    }
+
+    std::cout << "Open\n";
+    auto text = mappedFile.view();
+    bool footPrintGood{false};
+    bool headerRead = false;
+    ecoBee::DelimiterScanner scanner{text, ',', '\n'};
+    std::size_t lineStart{0}, fieldStart{0};
+    rowFields.clear();
+    while (fileGood && lineStart < text.size()) {
+        auto pos = scanner.next();
+        if (pos != ecoBee::DelimiterScanner::npos && text[pos] == ',') {
+            rowFields.push_back(text.substr(fieldStart, pos - fieldStart));
+            fieldStart = pos + 1;
+            continue;
+        }
+
+        // The end of a line, the same way std::getline would split it.
+        auto lineEnd = pos == ecoBee::DelimiterScanner::npos ? text.size() : pos;
+        auto line = text.substr(lineStart, lineEnd - lineStart);
+        if (fieldStart < lineEnd)
+            rowFields.push_back(text.substr(fieldStart, lineEnd - fieldStart));
+        lineStart = fieldStart = lineEnd + 1;
+
+        // Check the footprint.
+        if (!footPrintGood) {
+            if (!checkFootPrint(line))
+                return;
+            footPrintGood = true;
+        } else if (!line.empty() && line.front() != '#') {
+            if (headerRead) {
+                fileGood &= rowFields.size() == header.size() && lineFunction(line, DataView{rowFields});
+            } else {
+                if (headerRead = fileGood = processHeader(line); !headerRead)
+                    return;
+            }
+        }
+        rowFields.clear();
+    }
+}
+
+void EcoBeeDataFile::mapDataFile(const std::filesystem::path &file) {
+    scanMappedFile(file, [this](std::string_view line, const DataView &fields) {
+        // Rows are about the same length, size the field store from the first one.
+        if (mappedFields.empty()) {
+            auto text = mappedFile.view();
+            auto remaining = static_cast<std::size_t>(text.data() + text.size() - line.data());
+            mappedFields.reserve((remaining / (line.size() + 1) + 1) * header.size());
+        }
+        mappedFields.insert(mappedFields.end(), fields.begin(), fields.end());
+        return true;
+    });
+}
+
+void EcoBeeDataFile::loadColumns(const std::filesystem::path &file, std::span<const DataIndex> projection) {
+    bool projected{false};
+    scanMappedFile(file, [&](std::string_view line, const DataView &fields) {
+        if (!projected) {
+            std::vector<ColumnStore::Projection> columns{};
+            for (auto dataIndex : projection)
+                columns.push_back({static_cast<std::size_t>(dataIndex), columnType(dataIndex)});
+            columnStore.project(header.size(), DataIndex::Date, DataIndex::Time, columns);
+
+            // Rows are about the same length, size the columns from the first one.
+            auto text = mappedFile.view();
+            auto remaining = static_cast<std::size_t>(text.data() + text.size() - line.data());
+            columnStore.reserve(remaining / (line.size() + 1) + 1);
+            projected = true;
+        }
+        return columnStore.append(fields);
+    });
+}
+
+ColumnStore::ColumnType EcoBeeDataFile::columnType(std::size_t column) {
+    switch (column) {
+        case DataIndex::Date:
+        case DataIndex::Time:
+            return ColumnStore::ColumnType::Skipped;
+        case DataIndex::SystemSetting:
+        case DataIndex::SystemMode:
+        case DataIndex::CalendarEvent:
+        case DataIndex::ProgramMode:
+        case DataIndex::ThermostatMotion:
+            return ColumnStore::ColumnType::Dictionary;
+        case DataIndex::CoolStage1Sec:
+        case DataIndex::HeatStage1Sec:
+        case DataIndex::FanSec:
+            return ColumnStore::ColumnType::Seconds;
+        default:
+            // Remote sensors come in temperature, motion pairs.
+            if (column >= DataIndex::Sensor0Temp && (column - DataIndex::Sensor0Temp) % 2)
+                return ColumnStore::ColumnType::Dictionary;
+            return ColumnStore::ColumnType::Number;
+    }
+}
+
+bool EcoBeeDataFile::writeTimeState(InfluxBatch &influxPush, EcoBeeDataFile::StateDataItem &stateDataItem,
+                                    std::optional<unsigned long> value, SeriesKeys &seriesKeys) const {
+    auto timeStamp = influxPush.getMeasurementEpoch();
+    if (value) {
+        if (value.value() == 0 || value.value() == MaximumTimeValue) {
+            if (value.value() == 0 && stateDataItem.state) {
+                stateDataItem.state = false;
+            } else if (value.value() == MaximumTimeValue && !stateDataItem.state) {
+                stateDataItem.state = true;
+            }
+        } else {
+            if (stateDataItem.state) {
+                timeStamp += value.value() * 1000000000;
+                stateDataItem.state = false;
+            } else {
+                timeStamp += (MaximumTimeValue - value.value()) * 1000000000;
+                stateDataItem.state = true;
+            }
+        }
+    }
+    if (auto headerString = getRawHeader(stateDataItem.dataIndex); headerString.has_value()) {
+        const auto &seriesKey = seriesKeys.key(headerString.value());
+        if (value)
+            influxPush.addRuntime(seriesKey, static_cast<double>(value.value()), MaximumTimeValue);
+        influxPush.addState(seriesKey, (stateDataItem.state ? "true" : "false"), timeStamp);
+        return true;
+    }
+    return false;
+}
+
+std::string EcoBeeDataFile::escapeHeader(const std::string& hdr) {
+    auto workingHdr = hdr;
+    if (auto pos = workingHdr.rfind(" ("); pos != std::string::npos) {
+        workingHdr = workingHdr.substr(0, pos);
+    }
+
+    if (!workingHdr.empty())
+        for( auto pos = workingHdr.rfind(' '); pos > 0 && pos != std::string::npos; pos = workingHdr.rfind(' ', pos)) {
+            workingHdr.insert(pos, 1, '\\');
+        }
+
+    return workingHdr;
+}
+
+bool EcoBeeDataFile::processHeader(std::string_view line) {
+    forEachField(line, [this](std::string_view field) {
+        rawHeader.emplace_back(field);
+        header.push_back(escapeHeader(rawHeader.back()));
+    });
+    return !line.empty() && line.back() != ',';
+}
+
+bool EcoBeeDataFile::processData(const std::string &line) {
+    DataLine data;
+    forEachField(line, [&data](std::string_view field) {
+        data.emplace_back(field);
+    });
+    if (data.size() == header.size()) {
+        dataFile.push_back(data);
+        return true;
+    }
+    return false;
+}
+
+bool EcoBeeDataFile::splitRow(std::string_view line, std::vector<std::string_view> &fields) const {
+    fields.clear();
+    forEachField(line, [&fields](std::string_view field) {
+        fields.push_back(field);
+    });
+    return fields.size() == header.size();
+}
+
+bool EcoBeeDataFile::processMappedData(std::string_view line) {
+    if (!splitRow(line, rowFields))
+        return false;
+    mappedFields.insert(mappedFields.end(), rowFields.begin(), rowFields.end());
+    return true;
+}
@@ -0,0 +1,300 @@
+//
+// Created by richard on 2022-12-27.
+//
+
+/*
+ * EcoBeeDataFile.h Created by Richard Buckley (C) 2022-12-27
+ */
+
+/**
+ * @file EcoBeeDataFile.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2022-12-27
+ * @brief Abstract the CSV file made available by ecoBee
+ */
+
+#ifndef ECOBEEDATA_ECOBEEDATAFILE_H
+#define ECOBEEDATA_ECOBEEDATAFILE_H
+
+#include <array>
+#include <charconv>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ConfigFile.h"
+#include "InfluxBatch.h"
+#include "SeriesKeys.h"
+#include "ColumnStore.h"
+#include "DelimiterScanner.h"
+#include "MappedFile.h"
+
+/**
+ * @class EcoBeDataFile
+ * @brief Abstract the CSV file made available by ecoBee
+ * @details The file may be read in one of three ways. processDataFile() reads the file line by line into
+ * a DataFile of copied strings. mapDataFile() memory maps the file and keeps each field as a std::string_view
+ * into the mapping, the rows are then available from mappedRows() as DataView values. streamDataFile() also
+ * maps the file but hands each row to a callback as soon as it is split, no rows are stored. loadColumns()
+ * converts a projection of the columns into a typed ColumnStore.
+ */
+class EcoBeeDataFile {
+public:
+    using DataLine = std::vector<std::string>;
+    using DataFile = std::vector<DataLine>;
+    using DataView = std::span<const std::string_view>;
+    constexpr static unsigned long MaximumTimeValue = 300;
+    /**
+     * Indexes into the header and data vectors.
+     */
+    enum DataIndex {
+        Date [[maybe_unused]],
+        Time [[maybe_unused]],
+        SystemSetting [[maybe_unused]],
+        SystemMode [[maybe_unused]],
+        CalendarEvent [[maybe_unused]],
+        ProgramMode [[maybe_unused]],
+        CoolSetTemp [[maybe_unused]],
+        HeatSetTemp [[maybe_unused]],
+        CurrentTemp [[maybe_unused]],
+        CurrentHumidity [[maybe_unused]],
+        OutdoorTemp [[maybe_unused]],
+        WindSpeed [[maybe_unused]],
+        CoolStage1Sec [[maybe_unused]],
+        HeatStage1Sec [[maybe_unused]],
+        FanSec [[maybe_unused]],
+        DMOffset [[maybe_unused]],
+        ThermostatTemp [[maybe_unused]],
+        ThermostatHumidity [[maybe_unused]],
+        ThermostatMotion [[maybe_unused]],
+        ThermostatAirPressure [[maybe_unused]],
+        Sensor0Temp [[maybe_unused]],
+        Sensor0Motion [[maybe_unused]],
+        Sensor1Temp [[maybe_unused]],
+        Sensor1Motion [[maybe_unused]],
+        Sensor2Temp [[maybe_unused]],
+        Sensor2Motion [[maybe_unused]],
+        Sensor3Temp [[maybe_unused]],
+        Sensor3Motion [[maybe_unused]],
+    };
+
+    struct StateDataItem {
+        EcoBeeDataFile::DataIndex dataIndex;
+        bool state;
+    };
+
+private:
+    std::array<char, 3> footPrint{'\357', '\273', '\277'};  ///< Not really sure what this is, let's call it a footprint.
+    bool fileGood{true};    ///< True if the file passes parsing.
+    std::vector<std::string> header{};  ///< The data item headers.
+    std::vector<std::string> rawHeader{};   ///< The data item headers as they appear in the file.
+    DataFile dataFile;                  ///< The data in the file.
+    MappedFile mappedFile{};            ///< The mapping backing mappedFields.
+    std::vector<std::string_view> mappedFields{};   ///< Fields of all mapped rows, header.size() per row.
+    std::vector<std::string_view> rowFields{};      ///< Fields of the current streamed row.
+    ColumnStore columnStore{};          ///< The typed columns read by loadColumns().
+
+    bool checkFootPrint(std::string_view line) const;
+
+    /**
+     * @brief Map a file, check the footprint, process the header and pass each data line to a function.
+     * @details The whole mapping is split into lines and fields in a single pass of a DelimiterScanner.
+     * @param file The file path.
+     * @param lineFunction Called with each data line and its fields if it has a field for each header,
+     * returns false if the line is not valid.
+     */
+    void scanMappedFile(const std::filesystem::path &file,
+                        const std::function<bool(std::string_view, const DataView &)> &lineFunction);
+
+    bool splitRow(std::string_view line, std::vector<std::string_view> &fields) const;
+
+    /**
+     * @brief Call a function with each comma separated field of a line.
+     * @details As with the original std::string::find loop, an empty field after a trailing comma is not passed.
+     */
+    template<class FieldFunction>
+    static void forEachField(std::string_view line, FieldFunction &&fieldFunction) {
+        ecoBee::DelimiterScanner scanner{line, ',', ','};
+        std::size_t start = 0;
+        for (auto pos = scanner.next(); pos != ecoBee::DelimiterScanner::npos; pos = scanner.next()) {
+            fieldFunction(line.substr(start, pos - start));
+            start = pos + 1;
+        }
+        if (start < line.size())
+            fieldFunction(line.substr(start));
+    }
+
+public:
+    explicit operator bool() const noexcept {
+        return fileGood;
+    }
+
+    void processDataFile(const std::filesystem::path &file);
+
+    /**
+     * @brief Read the file through a memory mapping without copying the fields.
+     * @details The same footprint check and header processing as processDataFile() is applied. Data rows are
+     * split into std::string_view fields which remain valid for the lifetime of this object.
+     * @param file The file path.
+     */
+    void mapDataFile(const std::filesystem::path &file);
+
+    /**
+     * @brief Read the file through a memory mapping and process each row as it is split.
+     * @details Peak memory does not grow with the size of the file. The DataView passed to rowFunction is only
+     * valid for the duration of the call.
+     * @tparam RowFunction A callable taking a const DataView&.
+     * @param file The file path.
+     * @param rowFunction Called for each data row in file order.
+     */
+    template<class RowFunction>
+    void streamDataFile(const std::filesystem::path &file, RowFunction &&rowFunction) {
+        scanMappedFile(file, [&](std::string_view, const DataView &fields) {
+            rowFunction(fields);
+            return true;
+        });
+    }
+
+    /**
+     * @brief Read the file through a memory mapping into typed columns.
+     * @details Only the Date, Time and projected columns are converted and stored.
+     * @param file The file path.
+     * @param projection The columns to store.
+     */
+    void loadColumns(const std::filesystem::path &file, std::span<const DataIndex> projection);
+
+    [[nodiscard]] const ColumnStore &columns() const {
+        return columnStore;
+    }
+
+    /**
+     * @brief The storage type of a column in a ColumnStore.
+     */
+    static ColumnStore::ColumnType columnType(std::size_t column);
+
+    static std::string escapeHeader(const std::string& hdr);
+
+    bool processHeader(std::string_view line);
+
+    bool processData(const std::string& line);
+
+    bool processMappedData(std::string_view line);
+
+    template<class Line>
+    bool processTimeState(InfluxBatch &influxPush, EcoBeeDataFile::StateDataItem &stateDataItem,
+                          const Line &dataLine, SeriesKeys &seriesKeys) const;
+
+    /**
+     * @brief Advance the time state of an item and write it, adding its seconds to the rollup as runtime.
+     * @param influxPush The measurement destination.
+     * @param stateDataItem The item and its state from the previous row.
+     * @param value The operating seconds in this row, std::nullopt if the value could not be converted.
+     * @param seriesKeys The measurement series keys.
+     * @return True if a measurement was written.
+     */
+    bool writeTimeState(InfluxBatch &influxPush, EcoBeeDataFile::StateDataItem &stateDataItem,
+                        std::optional<unsigned long> value, SeriesKeys &seriesKeys) const;
+
+    template<class Line>
+    void processDMOffset(InfluxBatch &influxPush, const Line &dataLine, SeriesKeys &seriesKeys) const;
+
+    [[maybe_unused]] [[nodiscard]] size_t sensorCount() const {
+        if (fileGood) {
+            return (header.size() - Sensor0Temp) / 2;
+        }
+        return 0;
+    }
+
+    [[maybe_unused]] [[nodiscard]] std::optional<const std::string> getHeader(DataIndex dataIndex) const {
+        auto idx = static_cast<size_t>(dataIndex);
+        if (fileGood && idx < header.size())
+            return header[idx];
+        return std::nullopt;
+    }
+
+    /**
+     * @brief The header of a data item as it appears in the file, the key used with SeriesKeys.
+     */
+    [[maybe_unused]] [[nodiscard]] std::optional<std::string_view> getRawHeader(DataIndex dataIndex) const {
+        auto idx = static_cast<size_t>(dataIndex);
+        if (fileGood && idx < rawHeader.size())
+            return rawHeader[idx];
+        return std::nullopt;
+    }
+
+    [[maybe_unused]] [[nodiscard]] std::optional<const std::string> getData(DataIndex dataIndex, const DataLine &dataLine) const {
+        auto idx = static_cast<size_t>(dataIndex);
+        if (fileGood && idx < header.size())
+            return dataLine[idx];
+        return std::nullopt;
+    }
+
+    [[maybe_unused]] [[nodiscard]] std::optional<std::string_view> getData(DataIndex dataIndex, const DataView &dataView) const {
+        auto idx = static_cast<size_t>(dataIndex);
+        if (fileGood && idx < header.size() && idx < dataView.size())
+            return dataView[idx];
+        return std::nullopt;
+    }
+
+    [[maybe_unused]] [[nodiscard]] auto begin() const {
+        return dataFile.cbegin();
+    }
+
+    [[maybe_unused]] [[nodiscard]] auto end() const {
+        return dataFile.cend();
+    }
+
+    /**
+     * @brief The rows read by mapDataFile().
+     * @return A range of DataView, one per data row.
+     */
+    [[maybe_unused]] [[nodiscard]] auto mappedRows() const {
+        auto width = header.size();
+        auto rows = width ? mappedFields.size() / width : 0;
+        return std::views::iota(size_t{0}, rows) | std::views::transform([this, width](size_t row) {
+            return DataView{mappedFields.data() + row * width, width};
+        });
+    }
+};
+
+template<class Line>
+void EcoBeeDataFile::processDMOffset(InfluxBatch &influxPush, const Line &dataLine, SeriesKeys &seriesKeys) const {
+    if (auto name = getRawHeader(DataIndex::DMOffset); name.has_value()) {
+        if (auto dmOffset = getData(DataIndex::DMOffset, dataLine);
+                dmOffset.has_value() && !dmOffset.value().empty()) {
+            influxPush.addState(seriesKeys.key(name.value()), dmOffset.value());
+        } else {
+            influxPush.addState(seriesKeys.key(name.value()), "0.0");
+        }
+    } else {
+        std::cerr << "No name\n";
+    }
+}
+
+template<class Line>
+bool EcoBeeDataFile::processTimeState(InfluxBatch &influxPush, EcoBeeDataFile::StateDataItem &stateDataItem,
+                                      const Line &dataLine, SeriesKeys &seriesKeys) const {
+    try {
+        if (auto valueString = getData(stateDataItem.dataIndex, dataLine);
+                valueString.has_value() && !valueString.value().empty()) {
+            unsigned long seconds{};
+            const auto &text = valueString.value();
+            std::optional<unsigned long> value{};
+            if (std::from_chars(text.data(), text.data() + text.size(), seconds).ec == std::errc{})
+                value = seconds;
+            return writeTimeState(influxPush, stateDataItem, value, seriesKeys);
+        }
+        return false;
+    } catch (std::exception& e) {
+        std::cerr << e.what();
+        throw e;
+    }
+}
+
+#endif //ECOBEEDATA_ECOBEEDATAFILE_H
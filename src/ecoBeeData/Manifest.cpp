@@ -0,0 +1,111 @@
+/**
+ * @file Manifest.cpp
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include "Manifest.h"
+#include "AtomicFile.h"
+#include "MappedFile.h"
+
+namespace {
+    /**
+     * @brief The identity of a file without reading it.
+     */
+    bool fileIdentity(const std::filesystem::path &file, Manifest::Entry &entry) {
+        struct stat status{};
+        if (::stat(file.c_str(), &status) < 0)
+            return false;
+        entry.inode = status.st_ino;
+        entry.size = static_cast<std::uint64_t>(status.st_size);
+        entry.mtime = static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+        return true;
+    }
+}
+
+Manifest::Manifest(std::filesystem::path path) : mPath(std::move(path)) {
+    std::ifstream strm(mPath);
+    if (!strm)
+        return;
+
+    std::string line;
+    while (std::getline(strm, line)) {
+        std::istringstream fields{line};
+        Entry entry{};
+        std::string file{};
+        if (fields >> entry.inode >> entry.size >> entry.mtime >> entry.hash >> entry.rows >> entry.epoch
+                   >> entry.complete && fields.get() == ' ' && std::getline(fields, file)) {
+            if (std::filesystem::exists(file))
+                mEntries[file] = entry;
+        } else {
+            throw ManifestError("Manifest " + mPath.string() + " is not valid: " + line);
+        }
+    }
+}
+
+Manifest::Entry Manifest::resume(const std::filesystem::path &file) {
+    Entry current{};
+    if (!fileIdentity(file, current))
+        return current;
+
+    std::unique_lock<std::mutex> lock{mMutex};
+    auto itr = mEntries.find(file.string());
+    if (itr != mEntries.end() && itr->second.inode == current.inode && itr->second.size == current.size &&
+        itr->second.mtime == current.mtime)
+        return itr->second;
+    lock.unlock();
+
+    current.hash = contentHash(file);
+
+    lock.lock();
+    itr = mEntries.find(file.string());
+    if (itr != mEntries.end() && itr->second.size == current.size && itr->second.hash == current.hash) {
+        // The same content, copied or touched since it was recorded.
+        current.rows = itr->second.rows;
+        current.epoch = itr->second.epoch;
+        current.complete = itr->second.complete;
+    }
+    return current;
+}
+
+void Manifest::checkpoint(const std::filesystem::path &file, const Entry &entry) {
+    std::lock_guard<std::mutex> lock{mMutex};
+    mEntries[file.string()] = entry;
+    saveLocked();
+}
+
+void Manifest::erase(const std::filesystem::path &file) {
+    std::lock_guard<std::mutex> lock{mMutex};
+    if (mEntries.erase(file.string()))
+        saveLocked();
+}
+
+void Manifest::saveLocked() const {
+    std::ostringstream text{};
+    for (const auto &[file, entry] : mEntries) {
+        text << entry.inode << ' ' << entry.size << ' ' << entry.mtime << ' ' << entry.hash << ' '
+             << entry.rows << ' ' << entry.epoch << ' ' << entry.complete << ' ' << file << '\n';
+    }
+
+    try {
+        replaceFile(mPath, text.str());
+    } catch (const AtomicFileError &e) {
+        throw ManifestError(std::string{"Manifest "} + e.what());
+    }
+}
+
+std::uint64_t Manifest::contentHash(const std::filesystem::path &file) {
+    MappedFile mappedFile{};
+    if (!mappedFile.map(file))
+        throw ManifestError(file.string() + ": " + strerror(errno));
+
+    std::uint64_t hash = 14695981039346656037ull;
+    for (auto c : mappedFile.view()) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
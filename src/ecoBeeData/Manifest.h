@@ -0,0 +1,89 @@
+/**
+ * @file Manifest.h
+ * @brief A record of the report files that have been ingested.
+ * @details Each entry identifies a file by inode, size, modification time and a hash of its content, and
+ * records how many data rows of it have been written to the database. Unchanged files that were completely
+ * ingested are skipped, files that were interrupted resume after the last row written.
+ */
+
+#ifndef ECOBEEDATA_MANIFEST_H
+#define ECOBEEDATA_MANIFEST_H
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include "InfluxBatch.h"
+
+class ManifestError : public std::runtime_error {
+public:
+    explicit ManifestError(const std::string& what_arg) : std::runtime_error(what_arg) {}
+};
+
+/**
+ * @class Manifest
+ * @details The manifest is a text file with one line per report file. It is replaced atomically on each save
+ * so it is never left partly written. All members may be called from more than one thread.
+ */
+class Manifest {
+public:
+    struct Entry {
+        std::uint64_t inode{0};             ///< The file inode number.
+        std::uint64_t size{0};              ///< The file size in bytes.
+        std::int64_t mtime{0};              ///< The file modification time in nanoseconds.
+        std::uint64_t hash{0};              ///< FNV-1a hash of the file content.
+        std::size_t rows{0};                ///< The number of data rows written to the database.
+        InfluxBatch::Epoch epoch{0};        ///< The time stamp of the last data row written.
+        bool complete{false};               ///< True if every row has been written.
+    };
+
+private:
+    std::filesystem::path mPath;
+    std::map<std::string, Entry> mEntries{};
+    mutable std::mutex mMutex{};
+
+    void saveLocked() const;
+
+public:
+    Manifest() = delete;
+
+    /**
+     * @brief Read the manifest, a missing manifest is empty.
+     * @details Entries for files that no longer exist are dropped.
+     * @param path The manifest file path.
+     * @throws ManifestError if the manifest can not be read.
+     */
+    explicit Manifest(std::filesystem::path path);
+
+    /**
+     * @brief Find where to start ingesting a file.
+     * @details The content hash is only computed when the inode, size or modification time differ from the
+     * recorded entry. A file with different content starts over from the first row.
+     * @param file The report file.
+     * @return The entry to continue from, if complete is true the file does not need to be ingested.
+     */
+    Entry resume(const std::filesystem::path &file);
+
+    /**
+     * @brief Record the progress through a file and save the manifest.
+     * @param file The report file.
+     * @param entry The file entry.
+     * @throws ManifestError if the manifest can not be written.
+     */
+    void checkpoint(const std::filesystem::path &file, const Entry &entry);
+
+    /**
+     * @brief Drop the entry for a file and save the manifest.
+     */
+    void erase(const std::filesystem::path &file);
+
+    /**
+     * @brief The FNV-1a hash of a file's content.
+     * @throws ManifestError if the file can not be read.
+     */
+    static std::uint64_t contentHash(const std::filesystem::path &file);
+};
+
+#endif //ECOBEEDATA_MANIFEST_H
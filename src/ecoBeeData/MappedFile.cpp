@@ -0,0 +1,64 @@
+/**
+ * @file MappedFile.cpp
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include "MappedFile.h"
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+        : mAddress(std::exchange(other.mAddress, nullptr)), mLength(std::exchange(other.mLength, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        unmap();
+        mAddress = std::exchange(other.mAddress, nullptr);
+        mLength = std::exchange(other.mLength, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+void MappedFile::unmap() noexcept {
+    if (mAddress != nullptr)
+        munmap(mAddress, mLength);
+    mAddress = nullptr;
+    mLength = 0;
+}
+
+bool MappedFile::map(const std::filesystem::path &file) {
+    unmap();
+
+    auto fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat status{};
+    if (fstat(fd, &status) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    if (status.st_size > 0) {
+        auto length = static_cast<std::size_t>(status.st_size);
+        auto address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        // The file is read once from front to back.
+        madvise(address, length, MADV_SEQUENTIAL);
+        mAddress = address;
+        mLength = length;
+    }
+
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+    return true;
+}
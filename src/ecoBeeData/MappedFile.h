@@ -0,0 +1,49 @@
+/**
+ * @file MappedFile.h
+ * @brief A read only memory mapping of a data file.
+ * @details The mapping is the backing store for the std::string_view fields produced by the zero-copy
+ * readers, so it must outlive every view taken from it.
+ */
+
+#ifndef ECOBEEDATA_MAPPEDFILE_H
+#define ECOBEEDATA_MAPPEDFILE_H
+
+#include <filesystem>
+#include <string_view>
+
+/**
+ * @class MappedFile
+ * @brief RAII owner of a read only, private memory mapping of a whole file.
+ */
+class MappedFile {
+    void *mAddress{nullptr};    ///< Start of the mapping, nullptr if nothing is mapped.
+    std::size_t mLength{0};     ///< Length of the mapping in bytes.
+
+    void unmap() noexcept;
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    ~MappedFile();
+
+    /**
+     * @brief Map a file, replacing any existing mapping.
+     * @param file The path of the file to map.
+     * @return True on success, false with errno set on failure. An empty file maps successfully to an empty view.
+     */
+    bool map(const std::filesystem::path &file);
+
+    [[nodiscard]] std::string_view view() const noexcept {
+        if (mAddress == nullptr)
+            return std::string_view{};
+        return std::string_view{static_cast<const char *>(mAddress), mLength};
+    }
+};
+
+#endif //ECOBEEDATA_MAPPEDFILE_H